@@ -19,9 +19,31 @@
  */
 typedef struct _scp_bucket scp_bucket_t;
 
+/* Identifiers are assigned densely, in insertion order, starting at zero */
+#define SCP_INVALID_ID (-1U)
+
+/* Fingerprints are never zero, which denotes a fingerprint collision */
+#define SCP_INVALID_FINGERPRINT 0ULL
+
+/*
+ * Strategies used to retune the load factor and cellar ratio of the index at
+ * each rehash. `SCP_TUNING_FIXED` keeps whatever parameters were configured
+ * (initially 0.68/0.14), while the adaptive strategies sample probe lengths
+ * and cellar overflows between rehashes and move the parameters towards a
+ * denser table (`SCP_TUNING_MIN_MEMORY`) or shorter chains
+ * (`SCP_TUNING_MIN_LATENCY`).
+ */
+typedef enum _scp_tuning
+{
+  SCP_TUNING_FIXED = 0,
+  SCP_TUNING_MIN_MEMORY,
+  SCP_TUNING_MIN_LATENCY,
+} scp_tuning_t;
+
 typedef struct _scp_set
 {
   scp_bucket_t *table;
+  const char *arena; /* Base address that bucket keys are offsets into */
 
   uint32_t capacity;
   uint32_t table_capacity;
@@ -33,9 +55,35 @@ typedef struct _scp_set
   float load_factor;
   float cellar_ratio;
 
+  /* Statistics sampled since the last rehash, consumed by the tuner */
+  scp_tuning_t tuning;
+  uint64_t probes;    /* Buckets visited by sampled lookups */
+  uint32_t lookups;   /* Number of sampled lookups */
+  uint32_t overflows; /* Insertions that found the cellar exhausted */
+
+  /* Keys are hashed with a per-pool seeded djb2, unless abnormally long
+     chains were observed, in which case the set switches to HalfSipHash. */
+  uint64_t seed;
+  bool keyed;
+
+  /* Optional split-block Bloom filter that rejects most missing keys before
+     the table is touched; sized for the capacity and rebuilt at rehash. */
+  uint32_t *filter;
+  uint32_t filter_blocks;
+  uint32_t filter_bits; /* Bits per entry, or zero when disabled */
+
+  uint32_t threads; /* Workers used to rehash large tables */
+
   bool _dynamic;
 } scp_set_t;
 
+/*
+ * Callback invoked whenever a new string is interned, once it has received
+ * its identifier (see `scp_set_insert_hook(...)`).
+ */
+typedef void (*scp_insert_hook_t) (void *ctx, uint32_t id, const char *s,
+                                   size_t len);
+
 typedef struct _strpool
 {
   scp_set_t index;
@@ -43,6 +91,43 @@ typedef struct _strpool
 
   size_t capacity;
   size_t size;
+  uint32_t alignment; /* Alignment of string starts within the arena */
+
+  size_t *offsets; /* Arena offset of each string, indexed by identifier */
+  uint32_t offsets_capacity;
+
+  /* Length of each string, by identifier, kept once views were interned
+     (see `scp_intern_view(...)`), as views need not be null-terminated. */
+  uint32_t *lengths;
+
+  /* Optional content-derived identifiers (see `scp_set_fingerprints(...)`),
+     resolved through an open-addressed table of dense identifiers. */
+  uint64_t *fingerprints; /* Fingerprint of each string, by identifier */
+  uint32_t *fingerprint_table;
+  uint32_t fingerprint_capacity;
+  uint32_t fingerprint_collisions;
+
+  /* Optional fixed-size payload of each string (see `scp_set_payload_size`),
+     indexed by identifier so that a single probe of the index reaches it. */
+  char *payloads;
+  size_t payload_size; /* Bytes per string, or zero when disabled */
+
+  /* Optional occurrence counts (see `scp_set_counting(...)`), along with a
+     min-heap of the most frequent identifiers, updated at every intern. */
+  uint64_t *counts;   /* Interns of each string, by identifier */
+  uint32_t *heap;     /* Identifiers, the least frequent at the root */
+  uint32_t *heap_at;  /* Heap position of each identifier, or -1U */
+  uint32_t heap_size;
+  uint32_t heap_capacity; /* Number of heavy hitters tracked */
+
+  /* Lexicographic rank of each string, built on demand (see strpool_sort.h)
+     and only valid while `ranks_size` matches the size of the pool. */
+  uint32_t *ranks;
+  uint32_t ranks_size;
+
+  /* Optional observer of new strings, such as a write-ahead log */
+  scp_insert_hook_t insert_hook;
+  void *insert_hook_ctx;
 
   /* This field serves as a safeguard for de-allocation. Specifically, it is
    set within the `scp_new(...)` function to indicate dynamic allocation.
@@ -56,9 +141,66 @@ strpool_t *scp_new ();
 strpool_t *scp_init (strpool_t *pool);
 void scp_free (strpool_t *pool);
 
+/* ----- String Pool Tuning Functions --------- */
+bool scp_set_parameters (strpool_t *pool, float load_factor,
+                         float cellar_ratio);
+void scp_set_tuning (strpool_t *pool, scp_tuning_t tuning);
+void scp_set_seed (strpool_t *pool, uint64_t seed);
+void scp_set_filter (strpool_t *pool, uint32_t bits_per_key);
+bool scp_set_alignment (strpool_t *pool, uint32_t alignment);
+void scp_set_threads (strpool_t *pool, uint32_t threads);
+void scp_set_insert_hook (strpool_t *pool, scp_insert_hook_t hook,
+                          void *ctx);
+
+/* ----- String Pool Lookup Functions --------- */
+const char *scp_lookup_string (strpool_t *pool, const char *s);
+const char *scp_lookup_string_len (strpool_t *pool, const char *s, size_t n);
+
 /* ----- String Pool Insertion Functions ------ */
+/* Pooled strings live in a single arena, which may move when it grows; the
+   returned pointers are only valid until the next insertion of a new string. */
 const char *scp_insert_string (strpool_t *pool, const char *s);
 const char *scp_insert_string_len (strpool_t *pool, const char *s, size_t n);
+size_t scp_insert_strings (strpool_t *pool, const char *const *strs,
+                           const size_t *lens, size_t count, const char **out);
+
+/* ----- String Pool Identifier Functions ----- */
+uint32_t scp_insert_id (strpool_t *pool, const char *s, size_t n);
+uint32_t scp_lookup_id (strpool_t *pool, const char *s, size_t n);
+const char *scp_string (strpool_t *pool, uint32_t id);
+size_t scp_length (strpool_t *pool, uint32_t id);
+const char *scp_view (strpool_t *pool, uint32_t id, size_t *len);
+uint32_t scp_insert_bytes (strpool_t *pool, const char *s, size_t len);
+uint32_t scp_lookup_bytes (strpool_t *pool, const char *s, size_t len);
+
+/* ----- String Pool View Functions ----------- */
+uint32_t scp_intern_view (strpool_t *pool, uint32_t base_id, size_t offset,
+                          size_t len);
+
+/* ----- String Pool Payload Functions -------- */
+/* Payloads live in a single array, which may move when the pool grows; the
+   returned pointers are only valid until the next insertion of a new string. */
+void scp_set_payload_size (strpool_t *pool, size_t size);
+const char *scp_insert_string_payload (strpool_t *pool, const char *s,
+                                       size_t n, void **payload);
+void *scp_insert_payload (strpool_t *pool, const char *s, size_t n,
+                          uint32_t *id);
+void *scp_lookup_payload (strpool_t *pool, const char *s, size_t n);
+void *scp_payload (strpool_t *pool, uint32_t id);
+
+/* ----- String Pool Counting Functions ------- */
+void scp_set_counting (strpool_t *pool, uint32_t k);
+uint64_t scp_count (strpool_t *pool, uint32_t id);
+uint32_t scp_top_k (strpool_t *pool, uint32_t k, uint32_t *ids);
+
+/* ----- String Pool Fingerprint Functions ---- */
+void scp_set_fingerprints (strpool_t *pool, bool enabled);
+uint64_t scp_fingerprint (const char *s, size_t n);
+uint64_t scp_insert_fingerprint (strpool_t *pool, const char *s, size_t n);
+uint32_t scp_fingerprint_id (strpool_t *pool, uint64_t fingerprint);
+
+/* ----- String Pool Hashing Functions -------- */
+uint64_t scp_hash64 (const void *s, size_t n, uint64_t seed);
 
 /* ----- String Pool Diagnostic Functions ----- */
 uint32_t scp_size (strpool_t *pool);
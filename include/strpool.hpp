@@ -0,0 +1,398 @@
+/*
+ * strpool.hpp - [description]
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef STRPOOL_HPP
+#define STRPOOL_HPP 1
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+/*
+ * `libx::basic_string_pool` is a header-only counterpart of `strpool_t`
+ * whose hash function, index engine, allocator and identifier width are
+ * chosen at compile time, so the whole insertion path inlines without any
+ * dispatch. Like `strpool_t`, it copies strings into a single arena (with
+ * a terminator, so `string (id).data ()` may be handed to C), and assigns
+ * identifiers densely in insertion order.
+ *
+ *  - Hash: a callable `uint64_t (const char *s, std::size_t len)`, such as
+ *    `libx::djb2_hash` (the hash of strpool.h) or `libx::word_hash`.
+ *  - Index: `libx::linear_probing` or `libx::robin_hood`, both open
+ *    addressing over (hash, identifier) slots, so growing never rehashes a
+ *    string. The coalesced index of `strpool_t` remains the C library's.
+ *  - Allocator: any standard allocator, rebound for each internal array.
+ *  - IdType: an unsigned integer; its maximum value is the invalid id.
+ */
+namespace libx
+{
+
+namespace detail
+{
+
+/* Avalanches a 64-bit hash (murmur3's fmix64) */
+constexpr std::uint64_t
+mix (std::uint64_t h) noexcept
+{
+  h = (h ^ (h >> 33)) * 0xFF51AFD7ED558CCDULL;
+  h = (h ^ (h >> 33)) * 0xC4CEB9FE1A85EC53ULL;
+  return h ^ (h >> 33);
+}
+
+/* Maps the high half of a mixed hash onto [0, size), as strpool.h does */
+inline std::size_t
+home (std::uint32_t hash, std::size_t size) noexcept
+{
+  return static_cast<std::size_t> ((static_cast<std::uint64_t> (hash) * size)
+                                   >> 32);
+}
+
+} // namespace detail
+
+/* Seeded djb2, as used by the index of strpool.h */
+struct djb2_hash
+{
+  std::uint64_t seed = 5381U;
+
+  std::uint64_t
+  operator() (const char *s, std::size_t len) const noexcept
+  {
+    std::uint64_t h = seed;
+
+    for (std::size_t i = 0; i < len; ++i)
+      h = (h << 5) + h + static_cast<unsigned char> (s[i]);
+    return h;
+  }
+};
+
+/* One multiply per 8-byte word, for longer keys */
+struct word_hash
+{
+  std::uint64_t seed = 0x243F6A8885A308D3ULL;
+
+  std::uint64_t
+  operator() (const char *s, std::size_t len) const noexcept
+  {
+    std::uint64_t h = seed ^ len, w;
+    std::size_t i = 0;
+
+    for (; i + 8 <= len; i += 8)
+      {
+        std::memcpy (&w, s + i, 8);
+        h = (h ^ w) * 0x9E3779B97F4A7C15ULL;
+      }
+    if (i < len)
+      {
+        w = 0;
+        std::memcpy (&w, s + i, len - i);
+        h = (h ^ w) * 0x9E3779B97F4A7C15ULL;
+      }
+    return detail::mix (h);
+  }
+};
+
+/*
+ * Index engines map hashes to identifiers; the pool resolves collisions by
+ * comparing strings through the `equals` callable handed to `find(...)`.
+ * Hashes are mixed once more and slots are homed on their high half, so weak
+ * hashes (such as djb2 over short strings) still spread over the table.
+ */
+template <class IdType, class Allocator> class linear_probing
+{
+public:
+  static constexpr IdType npos = std::numeric_limits<IdType>::max ();
+
+  explicit linear_probing (const Allocator &alloc = Allocator ())
+      : slots_ (16, slot{ 0, npos }, alloc)
+  {
+  }
+
+  template <class Equals>
+  IdType
+  find (std::uint64_t hash, Equals &&equals) const
+  {
+    std::size_t mask = slots_.size () - 1;
+    std::uint32_t h = tag (hash);
+
+    for (std::size_t at = detail::home (h, slots_.size ());;
+         at = (at + 1) & mask)
+      {
+        const slot &s = slots_[at];
+        if (s.id == npos)
+          return npos;
+        if (s.hash == h && equals (s.id))
+          return s.id;
+      }
+  }
+
+  void
+  insert (std::uint64_t hash, IdType id)
+  {
+    if ((size_ + 1) * 2 > slots_.size ())
+      grow ();
+    place (slot{ tag (hash), id });
+    size_++;
+  }
+
+  std::size_t
+  memory_usage () const noexcept
+  {
+    return slots_.capacity () * sizeof (slot);
+  }
+
+private:
+  struct slot
+  {
+    std::uint32_t hash; /* High half of the mixed hash, enough to place it */
+    IdType id;
+  };
+  using slots_t = std::vector<
+      slot, typename std::allocator_traits<Allocator>::template rebind_alloc<
+                slot> >;
+
+  static std::uint32_t
+  tag (std::uint64_t hash) noexcept
+  {
+    return static_cast<std::uint32_t> (detail::mix (hash) >> 32);
+  }
+
+  void
+  place (slot s)
+  {
+    std::size_t mask = slots_.size () - 1;
+    std::size_t at = detail::home (s.hash, slots_.size ());
+
+    while (slots_[at].id != npos)
+      at = (at + 1) & mask;
+    slots_[at] = s;
+  }
+
+  void
+  grow ()
+  {
+    if (slots_.size () > std::numeric_limits<std::uint32_t>::max () / 2)
+      throw std::length_error ("libx::linear_probing: too many strings");
+
+    slots_t old (slots_.size () * 2, slot{ 0, npos },
+                 slots_.get_allocator ());
+    old.swap (slots_);
+    for (const slot &s : old)
+      if (s.id != npos)
+        place (s);
+  }
+
+  slots_t slots_;
+  std::size_t size_ = 0;
+};
+
+/*
+ * Robin Hood hashing: entries far from their home slot displace closer ones,
+ * which bounds the variance of probe lengths and lets unsuccessful lookups
+ * stop as soon as they are farther from home than the slot they visit.
+ */
+template <class IdType, class Allocator> class robin_hood
+{
+public:
+  static constexpr IdType npos = std::numeric_limits<IdType>::max ();
+
+  explicit robin_hood (const Allocator &alloc = Allocator ())
+      : slots_ (16, slot{ 0, 0, npos }, alloc)
+  {
+  }
+
+  template <class Equals>
+  IdType
+  find (std::uint64_t hash, Equals &&equals) const
+  {
+    std::size_t mask = slots_.size () - 1;
+    std::uint32_t h = tag (hash), distance = 0;
+
+    for (std::size_t at = detail::home (h, slots_.size ());;
+         at = (at + 1) & mask, ++distance)
+      {
+        const slot &s = slots_[at];
+        if (s.id == npos || s.distance < distance)
+          return npos;
+        if (s.hash == h && equals (s.id))
+          return s.id;
+      }
+  }
+
+  void
+  insert (std::uint64_t hash, IdType id)
+  {
+    /* A load factor of 7/8 keeps Robin Hood probes short */
+    if ((size_ + 1) * 8 > slots_.size () * 7)
+      grow ();
+    place (slot{ tag (hash), 0, id });
+    size_++;
+  }
+
+  std::size_t
+  memory_usage () const noexcept
+  {
+    return slots_.capacity () * sizeof (slot);
+  }
+
+private:
+  struct slot
+  {
+    std::uint32_t hash;
+    std::uint32_t distance; /* Distance from the home slot */
+    IdType id;
+  };
+  using slots_t = std::vector<
+      slot, typename std::allocator_traits<Allocator>::template rebind_alloc<
+                slot> >;
+
+  static std::uint32_t
+  tag (std::uint64_t hash) noexcept
+  {
+    return static_cast<std::uint32_t> (detail::mix (hash) >> 32);
+  }
+
+  void
+  place (slot s)
+  {
+    std::size_t mask = slots_.size () - 1;
+    std::size_t at = detail::home (s.hash, slots_.size ());
+
+    for (s.distance = 0;; at = (at + 1) & mask, ++s.distance)
+      {
+        if (slots_[at].id == npos)
+          {
+            slots_[at] = s;
+            return;
+          }
+        if (slots_[at].distance < s.distance)
+          std::swap (slots_[at], s);
+      }
+  }
+
+  void
+  grow ()
+  {
+    if (slots_.size () > std::numeric_limits<std::uint32_t>::max () / 2)
+      throw std::length_error ("libx::robin_hood: too many strings");
+
+    slots_t old (slots_.size () * 2, slot{ 0, 0, npos },
+                 slots_.get_allocator ());
+    old.swap (slots_);
+    for (const slot &s : old)
+      if (s.id != npos)
+        place (s);
+  }
+
+  slots_t slots_;
+  std::size_t size_ = 0;
+};
+
+template <class Hash = djb2_hash,
+          template <class, class> class Index = linear_probing,
+          class Allocator = std::allocator<char>,
+          class IdType = std::uint32_t>
+class basic_string_pool
+{
+  static_assert (std::numeric_limits<IdType>::is_integer
+                     && !std::numeric_limits<IdType>::is_signed,
+                 "IdType must be an unsigned integer");
+
+  template <class T>
+  using rebind_t =
+      typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
+
+public:
+  using id_type = IdType;
+  static constexpr IdType npos = std::numeric_limits<IdType>::max ();
+
+  explicit basic_string_pool (const Hash &hash = Hash (),
+                              const Allocator &alloc = Allocator ())
+      : hash_ (hash), index_ (alloc), arena_ (alloc), offsets_ (alloc),
+        lengths_ (alloc)
+  {
+  }
+
+  /* Interns a string, and retrieves its identifier */
+  IdType
+  insert (std::string_view s)
+  {
+    std::uint64_t h = hash_ (s.data (), s.size ());
+    IdType id = index_.find (h, equals_to (s));
+
+    if (id != npos)
+      return id;
+    if (offsets_.size () >= static_cast<std::size_t> (npos))
+      throw std::length_error ("libx::basic_string_pool: ids overflowed");
+    if (s.size () > std::numeric_limits<std::uint32_t>::max ())
+      throw std::length_error ("libx::basic_string_pool: string too long");
+
+    id = static_cast<IdType> (offsets_.size ());
+    offsets_.push_back (arena_.size ());
+    lengths_.push_back (static_cast<std::uint32_t> (s.size ()));
+    arena_.insert (arena_.end (), s.begin (), s.end ());
+    arena_.push_back ('\0');
+    index_.insert (h, id);
+    return id;
+  }
+
+  /* Retrieves the identifier of a string, or `npos` if it is missing */
+  IdType
+  lookup (std::string_view s) const
+  {
+    return index_.find (hash_ (s.data (), s.size ()), equals_to (s));
+  }
+
+  /* Resolves an identifier; the view is valid until the next insertion */
+  std::string_view
+  string (IdType id) const
+  {
+    return { arena_.data () + offsets_[id], lengths_[id] };
+  }
+
+  std::size_t
+  size () const noexcept
+  {
+    return offsets_.size ();
+  }
+
+  std::size_t
+  memory_usage () const noexcept
+  {
+    return sizeof (*this) + index_.memory_usage () + arena_.capacity ()
+           + offsets_.capacity () * sizeof (std::size_t)
+           + lengths_.capacity () * sizeof (std::uint32_t);
+  }
+
+private:
+  auto
+  equals_to (std::string_view s) const
+  {
+    return [this, s] (IdType id) {
+      return lengths_[id] == s.size ()
+             && std::memcmp (arena_.data () + offsets_[id], s.data (),
+                             s.size ())
+                    == 0;
+    };
+  }
+
+  Hash hash_;
+  Index<IdType, Allocator> index_;
+  std::vector<char, rebind_t<char> > arena_;
+  std::vector<std::size_t, rebind_t<std::size_t> > offsets_;
+  std::vector<std::uint32_t, rebind_t<std::uint32_t> > lengths_;
+};
+
+/* The configuration closest to `strpool_t` */
+using string_pool = basic_string_pool<>;
+
+} // namespace libx
+
+#endif /* STRPOOL_HPP */
@@ -0,0 +1,73 @@
+/*
+ * strpool_arrow.h - [description]
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef STRPOOL_ARROW_H
+#define STRPOOL_ARROW_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "strpool.h"
+#include "strpool_frozen.h"
+
+/*
+ * Structures of the Arrow C data interface, reproduced from the (stable) ABI
+ * specification so that no Arrow library is required. They are guarded by the
+ * same macro as Arrow's own `abi.h`, so both headers may be included.
+ * Source: https://arrow.apache.org/docs/format/CDataInterface.html
+ */
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema
+{
+  const char *format;
+  const char *name;
+  const char *metadata;
+  int64_t flags;
+  int64_t n_children;
+  struct ArrowSchema **children;
+  struct ArrowSchema *dictionary;
+  void (*release) (struct ArrowSchema *);
+  void *private_data;
+};
+
+struct ArrowArray
+{
+  int64_t length;
+  int64_t null_count;
+  int64_t offset;
+  int64_t n_buffers;
+  int64_t n_children;
+  const void **buffers;
+  struct ArrowArray **children;
+  struct ArrowArray *dictionary;
+  void (*release) (struct ArrowArray *);
+  void *private_data;
+};
+
+#endif /* ARROW_C_DATA_INTERFACE */
+
+/* ----- Arrow Import Functions --------------- */
+bool scp_arrow_import (strpool_t *pool, const struct ArrowSchema *schema,
+                       const struct ArrowArray *array, int32_t *indices);
+
+/* ----- Arrow Export Functions --------------- */
+/* Exported arrays reference the frozen pool (and the indices) without any
+   copy, which must therefore outlive the release of the arrays. */
+bool scp_arrow_export (const scp_frozen_t *frozen, bool binary,
+                       struct ArrowSchema *schema, struct ArrowArray *array);
+bool scp_arrow_export_dictionary (const scp_frozen_t *frozen, bool binary,
+                                  const int32_t *indices, int64_t length,
+                                  struct ArrowSchema *schema,
+                                  struct ArrowArray *array);
+
+#endif /* STRPOOL_ARROW_H */
@@ -0,0 +1,76 @@
+/*
+ * strpool_durable.h - [description]
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef STRPOOL_DURABLE_H
+#define STRPOOL_DURABLE_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "strpool.h"
+
+/*
+ * Controls when a durable pool flushes its mappings to stable storage.
+ *
+ * - NONE: insertions are published immediately, but never flushed; the pool
+ *   survives the crash of the process, not the crash of the system.
+ * - COMMIT: insertions are only published (and flushed) by an explicit call
+ *   to `scp_durable_commit(...)`, so that a group of them shares one flush.
+ * - ALWAYS: each insertion is committed before it returns.
+ */
+typedef enum
+{
+  SCP_SYNC_NONE,
+  SCP_SYNC_COMMIT,
+  SCP_SYNC_ALWAYS
+} scp_sync_t;
+
+/*
+ * A durable pool keeps its arena and its index within two memory mapped
+ * files, `path` and `path.idx`, which grow with the pool. Reopening a pool
+ * merely maps both files back: nothing is parsed or rehashed.
+ *
+ * Insertions write the string first, then its index entry, and finally
+ * publish both by advancing the committed size within the header of `path`.
+ * After a crash, the pool reopens as of its last commit; anything written
+ * past it is discarded.
+ */
+typedef struct _scp_durable
+{
+  char *data;             /* Mapping of `path`: header, then the arena */
+  size_t data_length;
+  void *index;            /* Mapping of `path.idx` */
+  size_t index_length;
+
+  uint64_t *offsets;      /* Arena offset of each string, by identifier */
+  uint64_t *slots;        /* Open addressing table: identifier and hash */
+  uint32_t id_capacity;
+  uint32_t slot_mask;
+
+  uint32_t size;          /* Strings inserted, committed or not */
+  uint32_t committed;     /* Strings published within the header */
+  uint64_t arena_size;
+  uint64_t committed_arena_size;
+
+  scp_sync_t sync;
+  char *path;
+  int fd, index_fd;
+} scp_durable_t;
+
+/* ----- Durable Pool Allocation Functions ----- */
+scp_durable_t *scp_durable_open (const char *path, scp_sync_t sync);
+bool scp_durable_close (scp_durable_t *pool);
+
+/* ----- Durable Pool Functions ---------------- */
+uint32_t scp_durable_insert (scp_durable_t *pool, const char *s, size_t n);
+uint32_t scp_durable_lookup (scp_durable_t *pool, const char *s, size_t n);
+const char *scp_durable_string (scp_durable_t *pool, uint32_t id);
+size_t scp_durable_length (scp_durable_t *pool, uint32_t id);
+uint32_t scp_durable_size (scp_durable_t *pool);
+bool scp_durable_commit (scp_durable_t *pool);
+
+#endif /* STRPOOL_DURABLE_H */
@@ -0,0 +1,63 @@
+/*
+ * strpool_fixed.h - [description]
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef STRPOOL_FIXED_H
+#define STRPOOL_FIXED_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "strpool.h"
+
+/*
+ * Fixed-width pools intern keys of a fixed number of bytes (UUIDs, digests,
+ * IPv6 addresses), which need neither an arena nor terminators. Each variant
+ * is generated for its width: keys are stored inline within the slots of an
+ * open-addressed (linear probing) index next to their identifier, compared
+ * a word at a time without branches, and hashed by a multiply per word.
+ * Identifiers are dense and assigned in insertion order, as within
+ * `strpool_t`, and a copy of every key is kept by identifier.
+ *
+ * Only `scp_fixed16_t` and `scp_fixed32_t` are provided. Both the
+ * declarations below and their definitions within strpool_fixed.c are
+ * generated by macros, though only the former are public; other widths
+ * require adding a definition to strpool_fixed.c.
+ */
+#define SCP_FIXED_DECLARE(name, width)                                        \
+  typedef struct _scp_##name##_slot                                           \
+  {                                                                           \
+    uint64_t key[(width) / 8U];                                               \
+    uint32_t id; /* Identifier of the key, or -1U if the slot is unused */    \
+  } scp_##name##_slot_t;                                                      \
+                                                                              \
+  typedef struct _scp_##name                                                  \
+  {                                                                           \
+    scp_##name##_slot_t *table;                                               \
+    uint64_t *keys; /* Key of each identifier, (width) / 8 words apart */     \
+                                                                              \
+    uint32_t capacity; /* Number of slots, a power of two */                  \
+    uint32_t size;                                                            \
+    uint32_t keys_capacity;                                                   \
+    uint64_t seed;                                                            \
+                                                                              \
+    bool _dynamic;                                                            \
+  } scp_##name##_t;                                                           \
+                                                                              \
+  scp_##name##_t *scp_##name##_new ();                                        \
+  scp_##name##_t *scp_##name##_init (scp_##name##_t *pool);                   \
+  void scp_##name##_free (scp_##name##_t *pool);                              \
+  uint32_t scp_##name##_insert (scp_##name##_t *pool, const void *key);       \
+  uint32_t scp_##name##_lookup (const scp_##name##_t *pool, const void *key); \
+  const void *scp_##name##_key (const scp_##name##_t *pool, uint32_t id);     \
+  uint32_t scp_##name##_size (const scp_##name##_t *pool);                    \
+  size_t scp_##name##_memory_usage (const scp_##name##_t *pool);
+
+/* ----- Fixed-Width Pool Functions ----------- */
+SCP_FIXED_DECLARE (fixed16, 16U)
+SCP_FIXED_DECLARE (fixed32, 32U)
+
+#endif /* STRPOOL_FIXED_H */
@@ -0,0 +1,74 @@
+/*
+ * strpool_frozen.h - [description]
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef STRPOOL_FROZEN_H
+#define STRPOOL_FROZEN_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "strpool.h"
+
+/*
+ * A frozen pool is an immutable snapshot of a string pool, indexed by a
+ * minimal-probe perfect hash function (one pilot and one slot per lookup).
+ * All of its sections live within a single position independent image, which
+ * may be written to disk and mapped back into memory without any parsing.
+ * Identifiers are preserved from the pool that was frozen, unless it was
+ * frozen by `scp_freeze_sorted(...)`, in which case identifiers follow the
+ * `strcmp(...)` order of their strings: comparisons, range predicates and
+ * sorting may then operate on the identifiers alone.
+ */
+typedef struct _scp_frozen
+{
+  const char *arena;
+  const uint64_t *offsets; /* String `i` spans [offsets[i], offsets[i+1]) */
+  const uint32_t *pilots;  /* Displacement of each perfect hash bucket */
+  const uint32_t *slots;   /* Identifier stored in each slot, or -1U */
+
+  uint32_t size;
+  uint32_t bucket_count;
+  uint32_t slot_count;
+  uint64_t seed;
+  bool sorted; /* Whether identifiers follow the order of their strings */
+
+  void *image;
+  size_t image_size;
+
+  bool _mapped; /* Whether `image` was mapped by `scp_frozen_open(...)` */
+} scp_frozen_t;
+
+/*
+ * Callback used to enumerate the strings of a frozen pool while it is built.
+ * It must return the string of identifier `id` and store its length in `n`.
+ */
+typedef const char *(*scp_frozen_source_t) (void *ctx, uint32_t id,
+                                            size_t *n);
+
+/* ----- Frozen Pool Allocation Functions ----- */
+scp_frozen_t *scp_freeze (strpool_t *pool);
+scp_frozen_t *scp_freeze_sorted (strpool_t *pool, uint32_t *remap);
+scp_frozen_t *scp_frozen_build (scp_frozen_source_t source, void *ctx,
+                                uint32_t count);
+void scp_frozen_free (scp_frozen_t *frozen);
+scp_frozen_t *scp_optimize_layout (const scp_frozen_t *frozen,
+                                   const uint64_t *counts, uint32_t *remap);
+
+/* ----- Frozen Pool Persistence Functions ---- */
+bool scp_frozen_save (const scp_frozen_t *frozen, const char *path);
+scp_frozen_t *scp_frozen_open (const char *path);
+
+/* ----- Frozen Pool Lookup Functions --------- */
+uint32_t scp_frozen_lookup (const scp_frozen_t *frozen, const char *s,
+                            size_t n);
+const char *scp_frozen_string (const scp_frozen_t *frozen, uint32_t id);
+size_t scp_frozen_length (const scp_frozen_t *frozen, uint32_t id);
+uint32_t scp_frozen_lower_bound (const scp_frozen_t *frozen, const char *s,
+                                 size_t n);
+uint32_t scp_frozen_size (const scp_frozen_t *frozen);
+
+#endif /* STRPOOL_FROZEN_H */
@@ -0,0 +1,49 @@
+/*
+ * strpool_gen.h - [description]
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef STRPOOL_GEN_H
+#define STRPOOL_GEN_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "strpool.h"
+#include "strpool_frozen.h"
+
+/*
+ * A generational pool layers a small mutable delta over a large frozen base.
+ * Identifiers [0, base size) belong to the base, and the following ones to
+ * the delta, in insertion order. Merging folds the delta into a new base
+ * (on a background thread) without renumbering anything, so identifiers are
+ * stable for the lifetime of the generational pool.
+ *
+ * The structure is opaque, as it holds the threading state of the merge; it
+ * isn't thread-safe itself: only the merge runs concurrently, and it never
+ * touches the fields of the pool until it is finished.
+ */
+typedef struct _scp_gen scp_gen_t;
+
+/* ----- Generational Pool Allocation Functions ----- */
+scp_gen_t *scp_gen_new ();
+scp_gen_t *scp_gen_init (scp_gen_t *gen, scp_frozen_t *base);
+void scp_gen_free (scp_gen_t *gen);
+
+/* ----- Generational Pool Functions ----------- */
+uint32_t scp_gen_insert (scp_gen_t *gen, const char *s, size_t n);
+uint32_t scp_gen_lookup (scp_gen_t *gen, const char *s, size_t n);
+const char *scp_gen_string (scp_gen_t *gen, uint32_t id);
+uint32_t scp_gen_size (scp_gen_t *gen);
+strpool_t *scp_gen_delta (scp_gen_t *gen);
+void scp_gen_set_insert_hook (scp_gen_t *gen, scp_insert_hook_t hook,
+                              void *ctx);
+
+/* ----- Generational Pool Merge Functions ----- */
+bool scp_gen_merge_start (scp_gen_t *gen);
+bool scp_gen_merge_finish (scp_gen_t *gen, bool wait);
+void scp_gen_merge (scp_gen_t *gen);
+
+#endif /* STRPOOL_GEN_H */
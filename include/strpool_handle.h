@@ -0,0 +1,38 @@
+/*
+ * strpool_handle.h - [description]
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef STRPOOL_HANDLE_H
+#define STRPOOL_HANDLE_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "strpool.h"
+
+/*
+ * A handle names a string within 64 bits. Strings of up to
+ * `SCP_HANDLE_INLINE_MAX` bytes are stored within the handle itself (their
+ * bytes in the low 56 bits, and their length in the tag byte), and never
+ * reach the pool; longer strings are interned, and their handle carries
+ * their identifier. Every string has a single handle, so handles are equal
+ * exactly when their strings are, and ordinary integer comparisons suffice.
+ */
+typedef uint64_t scp_handle_t;
+
+#define SCP_HANDLE_INLINE_MAX 7U
+#define SCP_INVALID_HANDLE (-1ULL)
+
+/* ----- Handle Functions --------------------- */
+scp_handle_t scp_handle_insert (strpool_t *pool, const char *s, size_t n);
+scp_handle_t scp_handle_lookup (strpool_t *pool, const char *s, size_t n);
+bool scp_handle_is_inline (scp_handle_t handle);
+uint32_t scp_handle_id (scp_handle_t handle);
+size_t scp_handle_length (strpool_t *pool, scp_handle_t handle);
+size_t scp_handle_copy (strpool_t *pool, scp_handle_t handle, char *buf,
+                        size_t size);
+
+#endif /* STRPOOL_HANDLE_H */
@@ -0,0 +1,78 @@
+/*
+ * strpool_log.h - [description]
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef STRPOOL_LOG_H
+#define STRPOOL_LOG_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "strpool.h"
+
+#define SCP_LOG_DUMP_MIN_BUFFER 64UL /* See `scp_log_dump(...)` */
+#define SCP_LOG_DEFAULT_DELAY 10U    /* Milliseconds, see above */
+
+/*
+ * An intern log is an append-only file recording every string added to a
+ * pool, as (identifier, length, bytes) records. Replaying it onto a snapshot
+ * of the pool (any pool holding the identifiers that preceded the log)
+ * restores the pool, and tailing it keeps a read replica in sync.
+ *
+ * Records are buffered, and written in batches; every `group` records, the
+ * batch is written and, if requested, flushed to stable storage at once
+ * (group commit). A batch is also committed once its buffer is full, or once
+ * its first record has waited for longer than the delay of the log. Both
+ * bounds are only checked as records are appended, so a writer going idle
+ * should call `scp_log_commit(...)` to commit the records it left behind. A
+ * checksum guards each record, so that a torn tail is detected, and
+ * truncated when the log is reopened.
+ *
+ * After a crash, `scp_log_recover(...)` rebuilds the pool from its latest
+ * snapshot (see strpool_snapshot.h) and the log.
+ */
+typedef struct _scp_log
+{
+  int fd;
+  char *buffer;
+  size_t buffer_size;
+  size_t buffer_capacity;
+
+  uint32_t pending; /* Records buffered since the last group commit */
+  uint32_t group;   /* Records per group commit */
+  uint64_t delay;   /* Longest wait of a buffered record, in nanoseconds */
+  uint64_t since;   /* Time the first pending record was buffered */
+  bool sync;        /* Whether group commits also flush the file */
+  int error;        /* First write error (`errno`), reported on commit */
+} scp_log_t;
+
+/* Reads the records of a log as they are appended */
+typedef struct _scp_log_follower
+{
+  int fd;
+  uint64_t offset; /* End of the last complete record read */
+  char *buffer;
+  size_t buffer_capacity;
+} scp_log_follower_t;
+
+/* ----- Intern Log Functions ----------------- */
+scp_log_t *scp_log_open (const char *path, uint32_t group, bool sync);
+bool scp_log_close (scp_log_t *log);
+void scp_log_attach (scp_log_t *log, strpool_t *pool);
+void scp_log_append (scp_log_t *log, uint32_t id, const char *s, size_t len);
+void scp_log_set_delay (scp_log_t *log, uint32_t delay_ms);
+bool scp_log_commit (scp_log_t *log);
+bool scp_log_dump (strpool_t *pool, uint32_t size, int fd, char *buffer,
+                   size_t capacity);
+
+/* ----- Intern Log Replay Functions ---------- */
+scp_log_follower_t *scp_log_follow (const char *path);
+uint32_t scp_log_poll (scp_log_follower_t *follower, strpool_t *pool);
+void scp_log_unfollow (scp_log_follower_t *follower);
+uint32_t scp_log_replay (strpool_t *pool, const char *path);
+strpool_t *scp_log_recover (const char *snapshot, const char *path);
+
+#endif /* STRPOOL_LOG_H */
@@ -0,0 +1,60 @@
+/*
+ * strpool_path.h - [description]
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef STRPOOL_PATH_H
+#define STRPOOL_PATH_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "strpool.h"
+#include "strpool_tuple.h"
+
+/*
+ * A path pool interns hierarchical names (file paths, URLs, dotted metric
+ * names) as a trie of (parent, component) pairs: components are interned
+ * once within a string pool, and each path is a pair of its parent path and
+ * its last component, hash-consed by a tuple pool. Paths sharing a prefix
+ * thus share its nodes, and prefix queries become walks over identifiers.
+ *
+ * Paths are split at every separator, so empty components (such as the one
+ * before the leading '/' of an absolute path) are kept, and every path is
+ * reconstructed exactly. Top-level components have no parent
+ * (`SCP_INVALID_ID`).
+ */
+typedef struct _scp_path
+{
+  strpool_t components;
+  scp_tuple_t nodes; /* (parent, component) of each path */
+  char separator;
+
+  bool _dynamic;
+} scp_path_t;
+
+/* ----- Path Pool Allocation Functions ------- */
+scp_path_t *scp_path_new ();
+scp_path_t *scp_path_init (scp_path_t *paths, char separator);
+void scp_path_free (scp_path_t *paths);
+
+/* ----- Path Pool Functions ------------------ */
+uint32_t scp_path_insert (scp_path_t *paths, const char *s, size_t n);
+uint32_t scp_path_lookup (scp_path_t *paths, const char *s, size_t n);
+size_t scp_path_string (scp_path_t *paths, uint32_t id, char *buf,
+                        size_t size);
+uint32_t scp_path_size (scp_path_t *paths);
+
+/* ----- Path Pool Navigation Functions ------- */
+uint32_t scp_path_child (scp_path_t *paths, uint32_t parent, const char *s,
+                         size_t n);
+uint32_t scp_path_find_child (scp_path_t *paths, uint32_t parent,
+                              const char *s, size_t n);
+uint32_t scp_path_parent (scp_path_t *paths, uint32_t id);
+const char *scp_path_component (scp_path_t *paths, uint32_t id);
+uint32_t scp_path_depth (scp_path_t *paths, uint32_t id);
+bool scp_path_has_prefix (scp_path_t *paths, uint32_t id, uint32_t prefix);
+
+#endif /* STRPOOL_PATH_H */
@@ -0,0 +1,49 @@
+/*
+ * strpool_snapshot.h - [description]
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef STRPOOL_SNAPSHOT_H
+#define STRPOOL_SNAPSHOT_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "strpool.h"
+
+typedef enum
+{
+  SCP_SNAPSHOT_RUNNING,
+  SCP_SNAPSHOT_DONE,
+  SCP_SNAPSHOT_FAILED
+} scp_snapshot_status_t;
+
+/*
+ * A background snapshot writes a point-in-time image of a pool while the
+ * pool keeps serving inserts. The image is written by a forked child, which
+ * sees the pool as it was when the snapshot started, the kernel copying the
+ * pages the parent modifies meanwhile.
+ *
+ * The image is an intern log holding every string of the pool (see
+ * strpool_log.h), so `scp_log_replay(...)` loads it back into an empty pool,
+ * and replaying the intern log written since then completes the recovery.
+ */
+typedef struct _scp_snapshot
+{
+  pid_t pid;
+  uint32_t size; /* Strings covered by the snapshot */
+
+  char *path;   /* Final path of the snapshot */
+  char *tmp;    /* Path written by the child, renamed once it succeeds */
+  char *buffer; /* Staging buffer of the child, allocated before forking */
+} scp_snapshot_t;
+
+/* ----- String Pool Snapshot Functions ------- */
+scp_snapshot_t *scp_snapshot_async (strpool_t *pool, const char *path);
+scp_snapshot_status_t scp_snapshot_finish (scp_snapshot_t *snapshot,
+                                           bool wait);
+
+#endif /* STRPOOL_SNAPSHOT_H */
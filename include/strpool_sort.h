@@ -0,0 +1,29 @@
+/*
+ * strpool_sort.h - [description]
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef STRPOOL_SORT_H
+#define STRPOOL_SORT_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "strpool.h"
+
+/*
+ * Strings are ranked by `strcmp(...)` order: rank `r` is held by the `r`-th
+ * smallest string of the pool. The rank table is built once, by a parallel
+ * MSD radix sort of the arena (using the threads of `scp_set_threads(...)`),
+ * and rebuilt whenever the pool has grown since. Sorting identifiers then
+ * merely sorts their ranks, without touching the arena.
+ */
+
+/* ----- String Pool Ordering Functions ------- */
+void scp_build_ranks (strpool_t *pool);
+uint32_t scp_rank (strpool_t *pool, uint32_t id);
+void scp_sort_ids (strpool_t *pool, uint32_t *ids, size_t n);
+
+#endif /* STRPOOL_SORT_H */
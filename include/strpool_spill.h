@@ -0,0 +1,62 @@
+/*
+ * strpool_spill.h - [description]
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef STRPOOL_SPILL_H
+#define STRPOOL_SPILL_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "strpool.h"
+
+/*
+ * Callback receiving each distinct string of a spilled set, along with its
+ * global identifier, while the set is being deduplicated.
+ */
+typedef void (*scp_spill_sink_t) (void *ctx, uint64_t id, const char *s,
+                                  size_t len);
+
+/*
+ * A spilled set deduplicates more distinct strings than fit in memory. The
+ * strings added to it are hash-partitioned into temporary files, each of
+ * which is then deduplicated on its own by an ordinary pool. A partition
+ * larger than the budget of the set (skewed keys, or too few partitions) is
+ * first split again, under a different hash, into as many smaller
+ * partitions as it needs. Global identifiers are dense, and assigned
+ * partition by partition (in insertion order within each partition).
+ *
+ * The budget bounds the size of a partition file, duplicates and length
+ * prefixes included, not memory: the pool deduplicating a partition holds
+ * each distinct string once, but also spends a bucket, an offset and some
+ * alignment on it (a few dozen bytes), so a budget should leave room for
+ * that overhead when strings are short and mostly distinct. Files are only
+ * ever read and written sequentially.
+ */
+typedef struct _scp_spill
+{
+  FILE **partitions;       /* Unlinked temporary files, one per partition */
+  char **buffers;          /* Write buffer of each partition */
+  uint64_t *sizes;         /* Bytes written to each partition */
+  uint32_t partition_count;
+  uint64_t seed;
+  uint64_t budget;         /* Largest partition deduplicated unsplit */
+  char *dir;               /* Directory of the partitions */
+
+  uint64_t count;          /* Strings added, duplicates included */
+  int error;               /* First I/O error (`errno`) */
+} scp_spill_t;
+
+/* ----- Spilled Set Functions ---------------- */
+scp_spill_t *scp_spill_new (const char *dir, uint32_t partitions);
+void scp_spill_free (scp_spill_t *spill);
+void scp_spill_set_budget (scp_spill_t *spill, uint64_t budget);
+void scp_spill_add (scp_spill_t *spill, const char *s, size_t n);
+uint64_t scp_spill_finish (scp_spill_t *spill, scp_spill_sink_t sink,
+                           void *ctx);
+
+#endif /* STRPOOL_SPILL_H */
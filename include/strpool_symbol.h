@@ -0,0 +1,81 @@
+/*
+ * strpool_symbol.h - [description]
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef STRPOOL_SYMBOL_H
+#define STRPOOL_SYMBOL_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "strpool.h"
+
+/*
+ * Identifiers of a pool are dense, so containers keyed by them need no
+ * hashing: a symbol map is a flat array of fixed-size values, along with a
+ * bit per identifier marking the values that are present, and a symbol set
+ * is just such a bitset. Both grow on demand (or along with a pool, through
+ * `scp_symmap_fit(...)` and `scp_symset_fit(...)`), and iterate in
+ * identifier order.
+ */
+typedef struct _scp_symmap
+{
+  char *values;      /* Value of identifier `i` at `values + i * value_size` */
+  uint64_t *present; /* Bit `i` is set if identifier `i` has a value */
+
+  size_t value_size;
+  uint32_t capacity; /* Number of identifiers covered, a multiple of 64 */
+  uint32_t size;     /* Number of identifiers with a value */
+
+  bool _dynamic;
+} scp_symmap_t;
+
+typedef struct _scp_symset
+{
+  uint64_t *words;
+  uint32_t capacity; /* Number of identifiers covered, a multiple of 64 */
+
+  bool _dynamic;
+} scp_symset_t;
+
+/* ----- Symbol Map Allocation Functions ------ */
+scp_symmap_t *scp_symmap_new ();
+scp_symmap_t *scp_symmap_init (scp_symmap_t *map, size_t value_size);
+void scp_symmap_free (scp_symmap_t *map);
+void scp_symmap_reserve (scp_symmap_t *map, uint32_t capacity);
+void scp_symmap_fit (scp_symmap_t *map, strpool_t *pool);
+
+/* ----- Symbol Map Functions ----------------- */
+void *scp_symmap_put (scp_symmap_t *map, uint32_t id, const void *value);
+void *scp_symmap_get (const scp_symmap_t *map, uint32_t id);
+bool scp_symmap_remove (scp_symmap_t *map, uint32_t id);
+void scp_symmap_clear (scp_symmap_t *map);
+uint32_t scp_symmap_next (const scp_symmap_t *map, uint32_t id);
+uint32_t scp_symmap_size (const scp_symmap_t *map);
+
+/* ----- Symbol Set Allocation Functions ------ */
+scp_symset_t *scp_symset_new ();
+scp_symset_t *scp_symset_init (scp_symset_t *set);
+void scp_symset_free (scp_symset_t *set);
+void scp_symset_reserve (scp_symset_t *set, uint32_t capacity);
+void scp_symset_fit (scp_symset_t *set, strpool_t *pool);
+
+/* ----- Symbol Set Functions ----------------- */
+bool scp_symset_add (scp_symset_t *set, uint32_t id);
+bool scp_symset_remove (scp_symset_t *set, uint32_t id);
+bool scp_symset_contains (const scp_symset_t *set, uint32_t id);
+void scp_symset_clear (scp_symset_t *set);
+uint32_t scp_symset_next (const scp_symset_t *set, uint32_t id);
+uint32_t scp_symset_count (const scp_symset_t *set);
+
+/* ----- Symbol Set Algebra Functions --------- */
+void scp_symset_union (scp_symset_t *set, const scp_symset_t *other);
+void scp_symset_intersect (scp_symset_t *set, const scp_symset_t *other);
+void scp_symset_difference (scp_symset_t *set, const scp_symset_t *other);
+uint32_t scp_symset_intersect_count (const scp_symset_t *set,
+                                     const scp_symset_t *other);
+
+#endif /* STRPOOL_SYMBOL_H */
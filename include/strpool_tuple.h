@@ -0,0 +1,48 @@
+/*
+ * strpool_tuple.h - [description]
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#ifndef STRPOOL_TUPLE_H
+#define STRPOOL_TUPLE_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "strpool.h"
+
+/*
+ * A tuple pool hash-conses sequences of identifiers (typically those of a
+ * string pool) into identifiers of their own, so that composite keys such as
+ * (host, path) need no concatenated string. Tuples are stored as raw arrays
+ * of identifiers within the arena of an inner pool, and indexed by the same
+ * coalesced hash set, through its byte-oriented functions. Pools of a fixed
+ * arity store nothing but the identifiers; variable-length tuples are
+ * prefixed with their length.
+ */
+typedef struct _scp_tuple
+{
+  strpool_t pool;
+  uint32_t arity; /* Length of every tuple, or zero if they vary */
+
+  bool _dynamic;
+} scp_tuple_t;
+
+/* ----- Tuple Pool Allocation Functions ------ */
+scp_tuple_t *scp_tuple_new ();
+scp_tuple_t *scp_tuple_init (scp_tuple_t *tuples, uint32_t arity);
+void scp_tuple_free (scp_tuple_t *tuples);
+
+/* ----- Tuple Pool Functions ----------------- */
+uint32_t scp_tuple_insert (scp_tuple_t *tuples, const uint32_t *ids,
+                           uint32_t n);
+uint32_t scp_tuple_lookup (scp_tuple_t *tuples, const uint32_t *ids,
+                           uint32_t n);
+const uint32_t *scp_tuple_get (scp_tuple_t *tuples, uint32_t id,
+                               uint32_t *n);
+uint32_t scp_tuple_size (scp_tuple_t *tuples);
+size_t scp_tuple_memory_usage (scp_tuple_t *tuples);
+
+#endif /* STRPOOL_TUPLE_H */
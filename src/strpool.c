@@ -9,31 +9,147 @@
 /* TODO: Shift scp_set capacities from powers of two towards primes */
 /* TODO: Shift hashing algorithms from djb2 towards crc32 */
 
+#define _POSIX_C_SOURCE 200809L /* strnlen(...) */
+
 #include "strpool.h"
 
 #include <errno.h>
+#include <pthread.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 struct _scp_bucket
 {
-  const char *key;
+  size_t key; /* Offset of the key within the arena (zero when unused) */
 
   uint32_t hash;
   uint32_t next;
+  uint32_t id; /* Identifier of the key, preserved across rehashes */
+  uint32_t len; /* Length of the key, compared before its bytes */
 };
 
 #define SCP_DEFAULT_INITIAL_CAPACITY 16
+#define SCP_DEFAULT_INITIAL_ENTRIES 16
+
+/* Zeroed bytes kept readable past the end of the last string of the arena, so
+   that word-sized loads may overrun any pooled string */
+#define SCP_ARENA_SLACK 32
+#define SCP_MAX_ALIGNMENT 64U
+
+/* Fingerprints must agree across processes, hence the fixed seed */
+#define SCP_FINGERPRINT_SEED 0x1F0C2B9D5E8A4763ULL
 
 /* Source: https://doi.org/10.1145/358728.358745 */
 #define SCP_SET_DEFAULT_INITIAL_CAPACITY 16
 #define SCP_SET_DEFAULT_CELLAR_RATIO 0.14
 #define SCP_SET_DEFAULT_LOAD_FACTOR 0.68
 
+/* Bounds and targets (in buckets visited per lookup) for adaptive tuning */
+#define SCP_TUNE_MIN_SAMPLES 64U
+#define SCP_TUNE_MEMORY_TARGET 2.0
+#define SCP_TUNE_LATENCY_TARGET 1.25
+#define SCP_TUNE_MIN_LOAD_FACTOR 0.50
+#define SCP_TUNE_MAX_LOAD_FACTOR 0.92
+#define SCP_TUNE_MIN_CELLAR_RATIO 0.06
+#define SCP_TUNE_MAX_CELLAR_RATIO 0.25
+
+/* Chains beyond these limits are treated as a hash-flooding attempt */
+#define SCP_SET_MAX_CHAIN_LENGTH 64U
+#define SCP_SET_MAX_COLLISIONS 16U
+
+/* Split-block Bloom filter: each block holds eight 32-bit words, and every
+   key sets one bit per word. Source: https://doi.org/10.1145/1498698.1594230 */
+#define SCP_FILTER_BLOCK_WORDS 8U
+#define SCP_FILTER_MAX_BITS 64U
+
+/* Tables below this capacity are always rehashed by the calling thread */
+#define SCP_PARALLEL_MIN_CAPACITY (1U << 16)
+#define SCP_MAX_THREADS 64U
+
+/* Number of lookups kept in flight by `scp_insert_strings(...)` */
+#define SCP_BATCH_INFLIGHT 16U
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SCP_PREFETCH(p) __builtin_prefetch ((p), 0, 3)
+#else
+#define SCP_PREFETCH(p) ((void)(p))
+#endif
+
+/* Progress of a single lookup interleaved by `scp_insert_strings(...)` */
+enum _scp_batch_stage
+{
+  SCP_BATCH_IDLE,   /* The slot holds no lookup */
+  SCP_BATCH_HASH,   /* The key must be (re)hashed */
+  SCP_BATCH_BUCKET, /* The bucket `at` has been prefetched */
+  SCP_BATCH_KEY,    /* The key of bucket `at` has been prefetched */
+};
+
+/* Entries that a rehash worker must hand over to another worker */
+struct _scp_rehash_outbox
+{
+  scp_bucket_t *entries;
+  size_t size;
+  size_t capacity;
+};
+
+/*
+ * State of a single rehash worker. Each worker exclusively owns a range of
+ * home buckets within the new table, and a slice of its cellar; collisions
+ * are resolved within those buckets, so that workers never share a bucket.
+ */
+struct _scp_rehash_worker
+{
+  scp_set_t *set;
+  const scp_bucket_t *old_table;
+  bool rehash_keys;
+
+  uint32_t index, count;    /* Position among the workers */
+  uint32_t from, to;        /* Slice of the old table to scan */
+  uint32_t lo, hi;          /* Home buckets owned within the new table */
+  uint32_t cellar_lo;       /* Cellar slice owned, filled downwards... */
+  uint32_t cellar_next;     /* ...from this bucket (exclusive) */
+
+  uint32_t placed, overflows;
+  struct _scp_rehash_worker *workers;
+  struct _scp_rehash_outbox *outboxes; /* One per destination worker */
+  struct _scp_rehash_outbox leftovers; /* Entries that found no room */
+};
+
+struct _scp_batch_slot
+{
+  enum _scp_batch_stage stage;
+  size_t index; /* Position of the key within the batch */
+  uint32_t hash;
+  uint32_t at;     /* Index of the bucket being visited */
+  size_t len;
+  uint32_t probes; /* Buckets visited, sampled for adaptive tuning */
+};
+
+/* Pairs a heavy hitter with its count, while they are being sorted */
+struct _scp_hitter
+{
+  uint64_t count;
+  uint32_t id;
+};
+
 static void scp_ensure_capacity (strpool_t *pool, size_t min);
 static size_t scp_new_capacity (strpool_t *pool, size_t min_capacity);
+static void scp_ensure_entries (strpool_t *pool, uint32_t min_entries);
+static scp_bucket_t *_scp_pool_intern (strpool_t *pool, const char *s,
+                                       size_t n);
+static scp_bucket_t *_scp_pool_intern_len (strpool_t *pool, const char *s,
+                                           size_t len);
+static void _scp_pool_added (strpool_t *pool, uint32_t id, size_t len);
+static void _scp_pool_track_lengths (strpool_t *pool);
+static const char *_scp_pool_terminate (strpool_t *pool,
+                                        scp_bucket_t *bucket);
+static void _scp_fingerprint_add (strpool_t *pool, uint32_t id, size_t len);
+static inline void _scp_count_hit (strpool_t *pool, uint32_t id);
+static void _scp_heap_sift (strpool_t *pool, uint32_t at);
+static int _scp_hitter_compare (const void *a, const void *b);
 
 static scp_set_t *_scp_set_new ();
 static scp_set_t *_scp_set_init (scp_set_t *index);
@@ -47,12 +163,45 @@ static inline const char *_scp_set_get (scp_set_t *set, const char *s, size_t n)
 static inline bool _scp_set_is_empty (scp_set_t *set);
 
 static scp_set_t *_scp_set_rehash (scp_set_t *set);
+static scp_set_t *_scp_set_resize (scp_set_t *set, uint32_t capacity,
+                                   bool rehash_keys);
+static void _scp_set_resize_parallel (scp_set_t *set,
+                                      const scp_bucket_t *old_table,
+                                      uint32_t old_capacity, bool rehash_keys);
+static void *_scp_rehash_scatter (void *arg);
+static void *_scp_rehash_gather (void *arg);
+static bool _scp_rehash_place (struct _scp_rehash_worker *worker,
+                               const scp_bucket_t *entry);
+static void _scp_outbox_push (struct _scp_rehash_outbox *outbox,
+                              const scp_bucket_t *entry);
+static inline uint32_t _scp_set_home (scp_set_t *set, uint32_t hash);
+static void _scp_set_tune (scp_set_t *set);
+static void _scp_filter_build (scp_set_t *set);
+static inline void _scp_filter_add (scp_set_t *set, uint32_t hash);
+static inline bool _scp_filter_contains (scp_set_t *set, uint32_t hash);
 static scp_bucket_t *_scp_bucket_find (scp_set_t *set, const char *s, size_t n,
                                        bool create, int *rflags);
+static scp_bucket_t *_scp_bucket_find_len (scp_set_t *set, const char *s,
+                                           size_t len, bool create,
+                                           int *rflags);
+static scp_bucket_t *_scp_bucket_link (scp_set_t *set, scp_bucket_t *chain,
+                                       uint32_t hash, size_t key, size_t len);
 static inline bool _scp_bucket_is_empty (scp_bucket_t *bucket);
+static inline bool _scp_key_equals (const scp_bucket_t *bucket,
+                                    const char *arena, const char *s,
+                                    size_t len);
+
+static inline uint32_t _scp_set_hash (scp_set_t *set, const char *s,
+                                      size_t len, bool padded);
+static uint64_t _scp_random_seed (void);
 
 /* Source: http://www.cse.yorku.ca/~oz/hash.html */
-static uint32_t _scp_set_djb2 (const char *s, size_t n);
+static uint32_t _scp_set_djb2 (const char *s, size_t len, uint32_t seed,
+                               bool padded);
+
+/* Source: https://github.com/veorq/SipHash (halfsiphash.c) */
+static uint32_t _scp_set_halfsiphash (const char *s, size_t len,
+                                      uint64_t key);
 
 /**
  * @brief Terminates the program execution due to a critical exception.
@@ -102,11 +251,33 @@ scp_init (strpool_t *pool)
   pool->index._dynamic = false;
   _scp_set_init (&pool->index);
 
-  pool->capacity = SCP_DEFAULT_INITIAL_CAPACITY;
-  pool->pool = malloc (pool->capacity);
+  pool->capacity = SCP_DEFAULT_INITIAL_CAPACITY + SCP_ARENA_SLACK;
+  pool->pool = calloc (pool->capacity, 1);
+  pool->alignment = 1U;
   if (!pool->pool)
     _die ("%s: Unable to allocate pool->pool (errno=%d)", __func__, errno);
 
+  /* Buckets reference keys by their offset into the arena, so that the arena
+     may be moved by `realloc(...)`. Offset zero is reserved to mark unused
+     buckets, hence the leading sentinel byte. */
+  pool->pool[0] = '\0';
+  pool->size = 1UL;
+  pool->index.arena = pool->pool;
+
+  pool->offsets_capacity = SCP_DEFAULT_INITIAL_ENTRIES;
+  pool->offsets = malloc (pool->offsets_capacity * sizeof (*pool->offsets));
+  if (!pool->offsets)
+    _die ("%s: Unable to allocate pool->offsets (errno=%d)", __func__, errno);
+
+  pool->fingerprints = NULL, pool->fingerprint_table = NULL;
+  pool->fingerprint_capacity = 0U, pool->fingerprint_collisions = 0U;
+  pool->insert_hook = NULL, pool->insert_hook_ctx = NULL;
+  pool->lengths = NULL;
+  pool->payloads = NULL, pool->payload_size = 0UL;
+  pool->counts = NULL, pool->heap = NULL, pool->heap_at = NULL;
+  pool->heap_size = 0U, pool->heap_capacity = 0U;
+  pool->ranks = NULL, pool->ranks_size = 0U;
+
   return pool;
 }
 
@@ -117,40 +288,1013 @@ scp_free (strpool_t *pool)
 
   if (pool->pool)
     free (pool->pool);
+  if (pool->offsets)
+    free (pool->offsets);
+  if (pool->fingerprints)
+    scp_set_fingerprints (pool, false);
+  free (pool->lengths);
+  free (pool->payloads);
+  if (pool->counts)
+    scp_set_counting (pool, 0U);
+  free (pool->ranks);
 
   /* Prevent stack-based pools from causing trouble :) */
   if (pool->_dynamic)
     free (pool);
 }
 
+/**
+ * @brief Overrides the load factor and cellar ratio of the pool's index.
+ *
+ * The load factor takes effect immediately, whereas the cellar ratio is only
+ * applied when the index is next rehashed. Unless the tuning strategy is
+ * `SCP_TUNING_FIXED`, the tuner may further adjust both parameters.
+ *
+ * @param pool The string pool whose index should be reconfigured.
+ * @param load_factor Maximum ratio of entries to buckets, in (0, 1).
+ * @param cellar_ratio Fraction of buckets reserved for the cellar, in [0, 1).
+ *
+ * @return `true` if the parameters were accepted, `false` otherwise.
+ */
+bool
+scp_set_parameters (strpool_t *pool, float load_factor, float cellar_ratio)
+{
+  if (!(load_factor > 0.0f && load_factor < 1.0f))
+    return false;
+  if (!(cellar_ratio >= 0.0f && cellar_ratio < 1.0f))
+    return false;
+
+  pool->index.load_factor = load_factor;
+  pool->index.cellar_ratio = cellar_ratio;
+  return true;
+}
+
+/**
+ * @brief Selects the strategy used to retune the pool's index at each rehash.
+ *
+ * @param pool The string pool whose index should be tuned.
+ * @param tuning The tuning strategy (see `scp_tuning_t`).
+ */
+void
+scp_set_tuning (strpool_t *pool, scp_tuning_t tuning)
+{
+  pool->index.tuning = tuning;
+  pool->index.probes = 0U, pool->index.lookups = 0U;
+  pool->index.overflows = 0U;
+}
+
+/**
+ * @brief Replaces the random seed of the pool's hash functions.
+ *
+ * Pools are seeded from the operating system's entropy source when they are
+ * initialized; an explicit seed is mostly useful for reproducible layouts.
+ * The index is rebuilt with the fast unkeyed hash under the new seed.
+ *
+ * @param pool The string pool whose index should be reseeded.
+ * @param seed The new seed.
+ */
+void
+scp_set_seed (strpool_t *pool, uint64_t seed)
+{
+  pool->index.seed = seed;
+  pool->index.keyed = false;
+  _scp_set_resize (&pool->index, pool->index.capacity, true);
+}
+
+/**
+ * @brief Sets the number of threads used to rehash large indices.
+ *
+ * When the index grows beyond `SCP_PARALLEL_MIN_CAPACITY` buckets, its
+ * entries are moved to the new table by up to `threads` workers, each one
+ * owning a contiguous range of the new table (see `_scp_set_home(...)`).
+ *
+ * @param pool The string pool to configure.
+ * @param threads The number of threads (1 rehashes serially), at most
+ * `SCP_MAX_THREADS`.
+ */
+void
+scp_set_threads (strpool_t *pool, uint32_t threads)
+{
+  pool->index.threads = threads < 1U               ? 1U
+                        : threads > SCP_MAX_THREADS ? SCP_MAX_THREADS
+                                                    : threads;
+}
+
+/**
+ * @brief Aligns the start of every string subsequently added to the pool.
+ *
+ * Regardless of the alignment, the arena always keeps `SCP_ARENA_SLACK`
+ * zeroed bytes past the end of its last string, so word-sized (or vector)
+ * loads may overrun any pooled string without crossing into unmapped memory.
+ * Aligned starts additionally keep such loads from straddling cache lines.
+ *
+ * @param pool The string pool to configure.
+ * @param alignment The alignment of string starts: a power of two, at most
+ * `SCP_MAX_ALIGNMENT` (typically 8 or 16; 1 disables alignment).
+ *
+ * @return `true` if the alignment was accepted, `false` otherwise.
+ */
+bool
+scp_set_alignment (strpool_t *pool, uint32_t alignment)
+{
+  if (!alignment || alignment > SCP_MAX_ALIGNMENT
+      || (alignment & (alignment - 1U)))
+    return false;
+
+  pool->alignment = alignment;
+  return true;
+}
+
+/**
+ * @brief Registers a callback observing every string added to the pool.
+ *
+ * The callback runs after the string has been copied into the arena and
+ * indexed, and receives the pooled copy, so it may neither insert into nor
+ * rehash the pool. Strings already present are not reported.
+ *
+ * @param pool The string pool to observe.
+ * @param hook The callback, or `NULL` to remove the current one.
+ * @param ctx An opaque pointer handed back to the callback.
+ */
+void
+scp_set_insert_hook (strpool_t *pool, scp_insert_hook_t hook, void *ctx)
+{
+  pool->insert_hook = hook, pool->insert_hook_ctx = ctx;
+}
+
+/**
+ * @brief Places a Bloom filter in front of the pool's index.
+ *
+ * The filter occupies `bits_per_key` bits for every entry the index may hold
+ * before it is next rehashed (8 bits yield a false positive rate of about
+ * 2%, 12 bits about 0.3%). Lookups of missing strings are then mostly
+ * rejected without touching the table or the arena. As the filter is derived
+ * from the 32-bit hash of the index, pools nearing 2^32 entries see the
+ * false positive rate rise with their hash collisions.
+ *
+ * @param pool The string pool whose index should be filtered.
+ * @param bits_per_key Bits allocated per entry (at most 64), or zero to remove
+ * the filter.
+ */
+void
+scp_set_filter (strpool_t *pool, uint32_t bits_per_key)
+{
+  scp_set_t *set = &pool->index;
+
+  set->filter_bits = bits_per_key > SCP_FILTER_MAX_BITS ? SCP_FILTER_MAX_BITS
+                                                        : bits_per_key;
+  _scp_filter_build (set);
+}
+
+const char *
+scp_lookup_string (strpool_t *pool, const char *s)
+{
+  return scp_lookup_string_len (pool, s, -1UL);
+}
+
+/**
+ * @brief Retrieves the pooled copy of a string without inserting it.
+ *
+ * @param pool The string pool to search.
+ * @param s The string to search for.
+ * @param n The maximum length of `s`, or `-1UL` if it is null-terminated.
+ *
+ * @return The pooled string, or `NULL` if the pool doesn't contain it, or
+ * only holds it as a view that isn't null-terminated (see
+ * `scp_intern_view(...)`).
+ */
+const char *
+scp_lookup_string_len (strpool_t *pool, const char *s, size_t n)
+{
+  scp_bucket_t *b = _scp_bucket_find (&pool->index, s, n, false, NULL);
+
+  if (!b || pool->pool[b->key + b->len] != '\0')
+    return NULL;
+  return pool->pool + b->key;
+}
+
 const char *
 scp_insert_string (strpool_t *pool, const char *s)
 {
   return scp_insert_string_len(pool, s, -1UL);
 }
 
+/**
+ * @brief Interns a string, and retrieves its pooled copy.
+ *
+ * Should the string only be held as a view that isn't null-terminated, it is
+ * copied into the arena (keeping its identifier), so that the returned
+ * string always is.
+ */
 const char *
 scp_insert_string_len (strpool_t *pool, const char *s, size_t n)
 {
-  uint32_t str_len;
-  const char *pooled_str = _scp_set_get (&pool->index, s, n);
+  return _scp_pool_terminate (pool, _scp_pool_intern (pool, s, n));
+}
+
+/**
+ * @brief Interns a string, and retrieves its identifier.
+ *
+ * Unlike pooled pointers, identifiers remain valid for the lifetime of the
+ * pool, and may be resolved back into strings with `scp_string(...)`.
+ *
+ * @param pool The string pool to insert the string into.
+ * @param s The string to intern.
+ * @param n The maximum length of `s`, or `-1UL` if it is null-terminated.
+ *
+ * @return The identifier of the string.
+ */
+uint32_t
+scp_insert_id (strpool_t *pool, const char *s, size_t n)
+{
+  return _scp_pool_intern (pool, s, n)->id;
+}
+
+/**
+ * @brief Retrieves the identifier of a string without inserting it.
+ *
+ * @return The identifier of the string, or `SCP_INVALID_ID` if the pool
+ * doesn't contain it.
+ */
+uint32_t
+scp_lookup_id (strpool_t *pool, const char *s, size_t n)
+{
+  scp_bucket_t *b = _scp_bucket_find (&pool->index, s, n, false, NULL);
+  return b ? b->id : SCP_INVALID_ID;
+}
 
-  /* If the string pool doesn't contain the string, insert the string */
-  if (!pooled_str)
+/**
+ * @brief Interns exactly `len` bytes, and retrieves their identifier.
+ *
+ * Unlike `scp_insert_id(...)`, the bytes aren't scanned for a terminator, and
+ * may even contain null bytes (the pooled copy is still null-terminated, but
+ * such strings are only found again through the `*_bytes` functions, and
+ * their length is only given by `scp_length(...)` and `scp_view(...)`).
+ *
+ * @return The identifier of the bytes.
+ */
+uint32_t
+scp_insert_bytes (strpool_t *pool, const char *s, size_t len)
+{
+  return _scp_pool_intern_len (pool, s, len)->id;
+}
+
+/**
+ * @brief Retrieves the identifier of exactly `len` bytes, without inserting
+ * them.
+ *
+ * @return The identifier of the bytes, or `SCP_INVALID_ID` if the pool
+ * doesn't contain them.
+ */
+uint32_t
+scp_lookup_bytes (strpool_t *pool, const char *s, size_t len)
+{
+  scp_bucket_t *b = _scp_bucket_find_len (&pool->index, s, len, false, NULL);
+  return b ? b->id : SCP_INVALID_ID;
+}
+
+/**
+ * @brief Resolves an identifier into its pooled string.
+ *
+ * @return The null-terminated pooled string, or `NULL` if the identifier is
+ * unknown or is a view that isn't null-terminated (see `scp_view(...)`).
+ */
+const char *
+scp_string (strpool_t *pool, uint32_t id)
+{
+  if (id >= pool->index.size
+      || (pool->lengths
+          && pool->pool[pool->offsets[id] + pool->lengths[id]] != '\0'))
+    return NULL;
+  return pool->pool + pool->offsets[id];
+}
+
+/**
+ * @brief Resolves an identifier into the bytes of its string, which are
+ * null-terminated unless the string is a view.
+ *
+ * @param pool The string pool.
+ * @param id The identifier of the string.
+ * @param len Receives the length of the string (may be `NULL`).
+ *
+ * @return The bytes of the string, or `NULL` if the identifier is unknown.
+ */
+const char *
+scp_view (strpool_t *pool, uint32_t id, size_t *len)
+{
+  if (id >= pool->index.size)
+    return NULL;
+  if (len)
+    *len = scp_length (pool, id);
+  return pool->pool + pool->offsets[id];
+}
+
+/**
+ * @brief Retrieves the length of a pooled string.
+ *
+ * Unlike `strlen(...)`, the length is exact for views, which may not be
+ * null-terminated, and for byte strings containing null bytes (the pool
+ * starts tracking the length of every string on the first of either).
+ *
+ * @return The length of the string, or zero if the identifier is unknown.
+ */
+size_t
+scp_length (strpool_t *pool, uint32_t id)
+{
+  if (id >= pool->index.size)
+    return 0UL;
+  return pool->lengths ? pool->lengths[id]
+                       : strlen (pool->pool + pool->offsets[id]);
+}
+
+/**
+ * @brief Interns a slice of a pooled string, without copying its bytes.
+ *
+ * The new entry references the bytes of its base string within the arena,
+ * so tokens of an interned line cost an index entry rather than a copy. If
+ * the slice was already interned (as a copy or a view), its identifier is
+ * returned instead. Views are only null-terminated when they end with their
+ * base string: the bytes of the others are only reachable through
+ * `scp_view(...)`, as `scp_string(...)` and `scp_lookup_string*(...)` return
+ * `NULL` for them, and `scp_insert_string*(...)` copy them into the arena
+ * first. The pool starts tracking the length of every string on its first
+ * view.
+ *
+ * @param pool The string pool containing the base string.
+ * @param base_id The identifier of the base string.
+ * @param offset The start of the slice within the base string.
+ * @param len The length of the slice.
+ *
+ * @return The identifier of the slice, or `SCP_INVALID_ID` if the base string
+ * is unknown, or the slice exceeds it or the 32-bit lengths of the index.
+ */
+uint32_t
+scp_intern_view (strpool_t *pool, uint32_t base_id, size_t offset, size_t len)
+{
+  scp_bucket_t *bucket;
+  size_t start;
+  int flags = 0;
+
+  if (base_id >= scp_size (pool) || offset > scp_length (pool, base_id)
+      || len > scp_length (pool, base_id) - offset || len > UINT32_MAX)
+    return SCP_INVALID_ID;
+
+  start = pool->offsets[base_id] + offset;
+  bucket = _scp_bucket_find_len (&pool->index, pool->pool + start, len, true,
+                                 &flags);
+  if (flags & 0x01)
     {
-      /* Cache string length to prevent repeat calls */
-      str_len = n == -1UL ? strlen (s) : n;
-      
-      scp_ensure_capacity (pool, pool->size + str_len);
+      scp_ensure_entries (pool, pool->index.size);
+      _scp_pool_track_lengths (pool);
+      pool->offsets[bucket->id] = start;
+      _scp_pool_added (pool, bucket->id, len);
+    }
+
+  if (pool->counts)
+    _scp_count_hit (pool, bucket->id);
+  return bucket->id;
+}
+
+/**
+ * @brief Attaches a fixed-size payload to every string of a pool.
+ *
+ * Payloads are stored by identifier, next to the offsets of the strings, so
+ * interning a string and reaching its payload takes a single probe of the
+ * index. Payloads of new strings start zeroed; when the size changes, the
+ * leading bytes of existing payloads are preserved.
+ *
+ * @param pool The string pool to (re)configure.
+ * @param size The size of each payload, in bytes (zero removes them).
+ */
+void
+scp_set_payload_size (strpool_t *pool, size_t size)
+{
+  char *payloads = NULL;
+  uint32_t id;
 
-      strncpy (pool->pool + pool->size, s, str_len);
-      pool->pool[pool->size + str_len] = '\0';
-      _scp_set_add (&pool->index, pool->pool + pool->size);
+  if (size == pool->payload_size)
+    return;
 
-      pool->size += str_len + 1; /* Null terminator */
+  if (size)
+    {
+      payloads = calloc (pool->offsets_capacity, size);
+      if (!payloads)
+        _die ("%s: Unable to allocate pool->payloads (errno=%d)", __func__,
+              errno);
+      for (id = 0U; id < scp_size (pool) && pool->payloads; ++id)
+        memcpy (payloads + id * size, pool->payloads + id * pool->payload_size,
+                size < pool->payload_size ? size : pool->payload_size);
     }
 
-  return pooled_str;
+  free (pool->payloads);
+  pool->payloads = payloads, pool->payload_size = size;
+}
+
+/**
+ * @brief Interns a string, and retrieves both its pooled copy and its
+ * payload.
+ *
+ * @param pool The string pool to insert the string into.
+ * @param s The string to intern.
+ * @param n The maximum length of `s`, or `-1UL` if it is null-terminated.
+ * @param payload Receives the payload of the string, or `NULL` if the pool
+ * has no payloads.
+ *
+ * @return The pooled string.
+ */
+const char *
+scp_insert_string_payload (strpool_t *pool, const char *s, size_t n,
+                           void **payload)
+{
+  scp_bucket_t *bucket = _scp_pool_intern (pool, s, n);
+
+  *payload = scp_payload (pool, bucket->id);
+  return _scp_pool_terminate (pool, bucket);
+}
+
+/**
+ * @brief Interns a string, and retrieves its payload (and identifier).
+ *
+ * @param id Receives the identifier of the string (may be `NULL`).
+ *
+ * @return The payload of the string, or `NULL` if the pool has no payloads.
+ */
+void *
+scp_insert_payload (strpool_t *pool, const char *s, size_t n, uint32_t *id)
+{
+  uint32_t found = _scp_pool_intern (pool, s, n)->id;
+
+  if (id)
+    *id = found;
+  return scp_payload (pool, found);
+}
+
+/**
+ * @brief Retrieves the payload of a string without inserting it.
+ *
+ * @return The payload of the string, or `NULL` if the pool doesn't contain
+ * the string or has no payloads.
+ */
+void *
+scp_lookup_payload (strpool_t *pool, const char *s, size_t n)
+{
+  scp_bucket_t *b = _scp_bucket_find (&pool->index, s, n, false, NULL);
+  return b ? scp_payload (pool, b->id) : NULL;
+}
+
+void *
+scp_payload (strpool_t *pool, uint32_t id)
+{
+  if (!pool->payloads || id >= pool->index.size)
+    return NULL;
+  return pool->payloads + id * pool->payload_size;
+}
+
+/**
+ * @brief Enables (or disables) occurrence counting for a pool.
+ *
+ * Every intern of a string, whether it adds the string or finds it, then
+ * increments its count. The `k` most frequent strings are tracked by a
+ * min-heap updated along with the counts: as counts only grow, a string
+ * outside the heap can only enter it by overtaking its root, so keeping the
+ * heavy hitters costs O(log k) per intern of a heavy hitter, and O(1)
+ * otherwise. Counts start at zero, even for strings already pooled.
+ *
+ * @param pool The string pool to (re)configure.
+ * @param k The number of heavy hitters to track, or zero to stop counting.
+ */
+void
+scp_set_counting (strpool_t *pool, uint32_t k)
+{
+  free (pool->counts), free (pool->heap), free (pool->heap_at);
+  pool->counts = NULL, pool->heap = NULL, pool->heap_at = NULL;
+  pool->heap_size = 0U, pool->heap_capacity = 0U;
+  if (!k)
+    return;
+
+  pool->counts = calloc (pool->offsets_capacity, sizeof (uint64_t));
+  pool->heap_at = malloc (pool->offsets_capacity * sizeof (uint32_t));
+  pool->heap = malloc (k * sizeof (uint32_t));
+  if (!pool->counts || !pool->heap_at || !pool->heap)
+    _die ("%s: Unable to allocate occurrence counts (errno=%d)", __func__,
+          errno);
+
+  memset (pool->heap_at, 0xFF, pool->offsets_capacity * sizeof (uint32_t));
+  pool->heap_capacity = k;
+}
+
+/**
+ * @brief Retrieves the number of times a string was interned since counting
+ * was enabled.
+ *
+ * @return The count, or zero if the pool isn't counting or `id` is unknown.
+ */
+uint64_t
+scp_count (strpool_t *pool, uint32_t id)
+{
+  return pool->counts && id < scp_size (pool) ? pool->counts[id] : 0U;
+}
+
+/**
+ * @brief Retrieves the most frequent strings of a counting pool.
+ *
+ * Only the tracked heavy hitters are sorted, never the whole pool.
+ *
+ * @param pool The string pool, with counting enabled.
+ * @param k The number of strings wanted, capped by the number tracked.
+ * @param ids Receives the identifiers, by decreasing count.
+ *
+ * @return The number of identifiers stored within `ids`.
+ */
+uint32_t
+scp_top_k (strpool_t *pool, uint32_t k, uint32_t *ids)
+{
+  struct _scp_hitter *hitters;
+  uint32_t i;
+
+  if (!pool->counts || !pool->heap_size)
+    return 0U;
+
+  hitters = malloc (pool->heap_size * sizeof (*hitters));
+  if (!hitters)
+    _die ("%s: Unable to allocate heavy hitters (errno=%d)", __func__, errno);
+  for (i = 0U; i < pool->heap_size; ++i)
+    hitters[i].count = pool->counts[pool->heap[i]],
+    hitters[i].id = pool->heap[i];
+  qsort (hitters, pool->heap_size, sizeof (*hitters), _scp_hitter_compare);
+
+  k = k < pool->heap_size ? k : pool->heap_size;
+  for (i = 0U; i < k; ++i)
+    ids[i] = hitters[i].id;
+  free (hitters);
+  return k;
+}
+
+/* Counts an intern of `id`, and promotes it among the heavy hitters */
+static inline void
+_scp_count_hit (strpool_t *pool, uint32_t id)
+{
+  uint32_t at = pool->heap_at[id];
+
+  pool->counts[id]++;
+  if (at != SCP_INVALID_ID)
+    _scp_heap_sift (pool, at); /* Its count grew, so it can only sink */
+  else if (pool->heap_size < pool->heap_capacity)
+    {
+      /* Raise the newcomer above every parent with a larger count */
+      at = pool->heap_size++;
+      while (at > 0U
+             && pool->counts[pool->heap[(at - 1U) / 2U]] > pool->counts[id])
+        {
+          pool->heap[at] = pool->heap[(at - 1U) / 2U];
+          pool->heap_at[pool->heap[at]] = at;
+          at = (at - 1U) / 2U;
+        }
+      pool->heap[at] = id, pool->heap_at[id] = at;
+    }
+  else if (pool->counts[id] > pool->counts[pool->heap[0]])
+    {
+      pool->heap_at[pool->heap[0]] = SCP_INVALID_ID;
+      pool->heap[0] = id, pool->heap_at[id] = 0U;
+      _scp_heap_sift (pool, 0U);
+    }
+}
+
+/* Sinks the entry at `at` below any child with a smaller count */
+static void
+_scp_heap_sift (strpool_t *pool, uint32_t at)
+{
+  uint32_t *heap = pool->heap, id = heap[at], child;
+  const uint64_t *counts = pool->counts;
+
+  while ((child = 2U * at + 1U) < pool->heap_size)
+    {
+      if (child + 1U < pool->heap_size
+          && counts[heap[child + 1U]] < counts[heap[child]])
+        child++;
+      if (counts[heap[child]] >= counts[id])
+        break;
+      heap[at] = heap[child], pool->heap_at[heap[at]] = at;
+      at = child;
+    }
+  heap[at] = id, pool->heap_at[id] = at;
+}
+
+/* Orders by decreasing count, then by increasing identifier */
+static int
+_scp_hitter_compare (const void *a, const void *b)
+{
+  const struct _scp_hitter *x = a, *y = b;
+
+  if (x->count != y->count)
+    return x->count < y->count ? 1 : -1;
+  return (x->id > y->id) - (x->id < y->id);
+}
+
+/**
+ * @brief Enables (or disables) content-derived fingerprints for a pool.
+ *
+ * A fingerprint is a 64-bit hash of the string alone (see
+ * `scp_fingerprint(...)`), so independent pools and processes agree on the
+ * fingerprint of every string without communicating. Enabling fingerprints
+ * computes them for the strings already pooled, and maintains them for every
+ * later insertion, however the string is inserted.
+ *
+ * @param pool The string pool to (re)configure.
+ * @param enabled Whether the pool should maintain fingerprints.
+ */
+void
+scp_set_fingerprints (strpool_t *pool, bool enabled)
+{
+  uint32_t id;
+
+  free (pool->fingerprints), free (pool->fingerprint_table);
+  pool->fingerprints = NULL, pool->fingerprint_table = NULL;
+  pool->fingerprint_capacity = 0U, pool->fingerprint_collisions = 0U;
+  if (!enabled)
+    return;
+
+  pool->fingerprints = malloc (pool->offsets_capacity * sizeof (uint64_t));
+  if (!pool->fingerprints)
+    _die ("%s: Unable to allocate pool->fingerprints (errno=%d)", __func__,
+          errno);
+
+  for (id = 0U; id < scp_size (pool); ++id)
+    _scp_fingerprint_add (pool, id, scp_length (pool, id));
+}
+
+/**
+ * @brief Computes the fingerprint of a string, without any pool.
+ *
+ * @param s The string to fingerprint.
+ * @param n The maximum length of `s`, or `-1UL` if it is null-terminated.
+ *
+ * @return The fingerprint of the string, which is never
+ * `SCP_INVALID_FINGERPRINT`.
+ */
+uint64_t
+scp_fingerprint (const char *s, size_t n)
+{
+  size_t len = n == -1UL ? strlen (s) : strnlen (s, n);
+  uint64_t fingerprint = scp_hash64 (s, len, SCP_FINGERPRINT_SEED);
+
+  return fingerprint ? fingerprint : 1ULL;
+}
+
+/**
+ * @brief Interns a string, and retrieves its fingerprint.
+ *
+ * The pool verifies that no other string shares the fingerprint. Should one
+ * collide, the string is still interned (and keeps its dense identifier),
+ * but doesn't receive a fingerprint.
+ *
+ * @param pool The string pool to insert the string into, with fingerprints
+ * enabled.
+ * @param s The string to intern.
+ * @param n The maximum length of `s`, or `-1UL` if it is null-terminated.
+ *
+ * @return The fingerprint of the string, or `SCP_INVALID_FINGERPRINT` if it
+ * collides with another string of the pool.
+ */
+uint64_t
+scp_insert_fingerprint (strpool_t *pool, const char *s, size_t n)
+{
+  uint32_t id = _scp_pool_intern (pool, s, n)->id;
+  return pool->fingerprints ? pool->fingerprints[id] : SCP_INVALID_FINGERPRINT;
+}
+
+/**
+ * @brief Resolves a fingerprint into the identifier of its string.
+ *
+ * @return The identifier, or `SCP_INVALID_ID` if no string of the pool has
+ * the fingerprint.
+ */
+uint32_t
+scp_fingerprint_id (strpool_t *pool, uint64_t fingerprint)
+{
+  uint32_t mask = pool->fingerprint_capacity - 1U, at, id;
+
+  if (!pool->fingerprint_table || fingerprint == SCP_INVALID_FINGERPRINT)
+    return SCP_INVALID_ID;
+
+  for (at = fingerprint & mask;; at = (at + 1U) & mask)
+    {
+      id = pool->fingerprint_table[at];
+      if (id == SCP_INVALID_ID || pool->fingerprints[id] == fingerprint)
+        return id;
+    }
+}
+
+/**
+ * @brief Fingerprints a pooled string, and registers it within the table of
+ * fingerprints (growing it beyond half occupancy).
+ *
+ * @param pool The string pool, with fingerprints enabled.
+ * @param id The identifier of the string to fingerprint.
+ * @param len The length of the string.
+ */
+static void
+_scp_fingerprint_add (strpool_t *pool, uint32_t id, size_t len)
+{
+  uint32_t mask, at, i, *old_table = pool->fingerprint_table;
+  uint32_t old_capacity = pool->fingerprint_capacity;
+  uint64_t fingerprint = scp_hash64 (scp_view (pool, id, NULL), len,
+                                     SCP_FINGERPRINT_SEED);
+
+  fingerprint = fingerprint ? fingerprint : 1ULL; /* See `scp_fingerprint` */
+
+  if ((id + 1ULL) * 2U > pool->fingerprint_capacity)
+    {
+      pool->fingerprint_capacity
+          = old_capacity ? old_capacity << 1 : SCP_DEFAULT_INITIAL_ENTRIES;
+      pool->fingerprint_table = malloc (pool->fingerprint_capacity
+                                        * sizeof (*pool->fingerprint_table));
+      if (!pool->fingerprint_table)
+        _die ("%s: Unable to allocate pool->fingerprint_table (errno=%d)",
+              __func__, errno);
+      memset (pool->fingerprint_table, 0xFF,
+              pool->fingerprint_capacity * sizeof (uint32_t));
+
+      mask = pool->fingerprint_capacity - 1U;
+      for (i = 0U; i < old_capacity; ++i)
+        if (old_table[i] != SCP_INVALID_ID)
+          {
+            at = pool->fingerprints[old_table[i]] & mask;
+            while (pool->fingerprint_table[at] != SCP_INVALID_ID)
+              at = (at + 1U) & mask;
+            pool->fingerprint_table[at] = old_table[i];
+          }
+      free (old_table);
+    }
+
+  if (scp_fingerprint_id (pool, fingerprint) != SCP_INVALID_ID)
+    {
+      /* Another string owns the fingerprint; keep its registration */
+      pool->fingerprints[id] = SCP_INVALID_FINGERPRINT;
+      pool->fingerprint_collisions++;
+      return;
+    }
+
+  mask = pool->fingerprint_capacity - 1U;
+  for (at = fingerprint & mask; pool->fingerprint_table[at] != SCP_INVALID_ID;
+       at = (at + 1U) & mask)
+    ;
+  pool->fingerprint_table[at] = id;
+  pool->fingerprints[id] = fingerprint;
+}
+
+/**
+ * @brief Finds the bucket of a string, copying the string into the arena (and
+ * assigning it the next identifier) if the pool doesn't contain it yet.
+ *
+ * @return The bucket of the string, valid until the index is next rehashed.
+ */
+static scp_bucket_t *
+_scp_pool_intern (strpool_t *pool, const char *s, size_t n)
+{
+  /* Cache string length to prevent repeat calls */
+  return _scp_pool_intern_len (pool, s,
+                               n == -1UL ? strlen (s) : strnlen (s, n));
+}
+
+/**
+ * @brief Interns exactly `str_len` bytes, see `_scp_pool_intern(...)`.
+ */
+static scp_bucket_t *
+_scp_pool_intern_len (strpool_t *pool, const char *s, size_t str_len)
+{
+  size_t start;
+  int flags = 0;
+  /* A single walk of the chain: a missing key is linked right away, still
+     referencing the caller's bytes, and only then copied into the arena */
+  scp_bucket_t *bucket
+      = _scp_bucket_find_len (&pool->index, s, str_len, true, &flags);
+
+  /* If the string pool didn't contain the string, copy the string */
+  if (flags & 0x01)
+    {
+      /* Padding between strings is already zeroed (see the slack) */
+      start = (pool->size + pool->alignment - 1) & ~(pool->alignment - 1UL);
+      scp_ensure_capacity (pool, start + str_len + 1);
+      scp_ensure_entries (pool, pool->index.size);
+
+      memcpy (pool->pool + start, s, str_len);
+      pool->pool[start + str_len] = '\0';
+      bucket->key = start;
+      pool->offsets[bucket->id] = start;
+
+      pool->size = start + str_len + 1; /* Null terminator */
+      _scp_pool_added (pool, bucket->id, str_len);
+    }
+
+  if (pool->counts)
+    _scp_count_hit (pool, bucket->id);
+  return bucket;
+}
+
+/**
+ * @brief Retrieves the null-terminated pooled copy of a string, copying it
+ * to the end of the arena (under the same identifier) if it is a view that
+ * isn't null-terminated.
+ */
+static const char *
+_scp_pool_terminate (strpool_t *pool, scp_bucket_t *bucket)
+{
+  size_t start;
+
+  if (pool->pool[bucket->key + bucket->len] == '\0')
+    return pool->pool + bucket->key;
+
+  /* The bucket stays valid, as only the arena may move */
+  start = (pool->size + pool->alignment - 1) & ~(pool->alignment - 1UL);
+  scp_ensure_capacity (pool, start + bucket->len + 1);
+  memcpy (pool->pool + start, pool->pool + bucket->key, bucket->len);
+  pool->pool[start + bucket->len] = '\0';
+
+  bucket->key = start, pool->offsets[bucket->id] = start;
+  pool->size = start + bucket->len + 1; /* Null terminator */
+  return pool->pool + start;
+}
+
+/**
+ * @brief Initializes the side tables of a string that was just added to the
+ * pool (at `pool->offsets[id]`), and reports it to the insertion hook.
+ */
+static void
+_scp_pool_added (strpool_t *pool, uint32_t id, size_t len)
+{
+  /* `strlen(...)` would truncate byte strings holding null bytes */
+  if (!pool->lengths && memchr (pool->pool + pool->offsets[id], '\0', len))
+    _scp_pool_track_lengths (pool);
+
+  if (pool->lengths)
+    pool->lengths[id] = len;
+  if (pool->payloads)
+    memset (pool->payloads + id * pool->payload_size, 0, pool->payload_size);
+  if (pool->counts)
+    pool->counts[id] = 0U, pool->heap_at[id] = -1U;
+  if (pool->fingerprints)
+    _scp_fingerprint_add (pool, id, len);
+  if (pool->insert_hook)
+    pool->insert_hook (pool->insert_hook_ctx, id,
+                       pool->pool + pool->offsets[id], len);
+}
+
+/**
+ * @brief Starts tracking the length of every string, filled from the index
+ * for the strings already pooled.
+ */
+static void
+_scp_pool_track_lengths (strpool_t *pool)
+{
+  uint32_t i;
+
+  if (pool->lengths)
+    return;
+
+  pool->lengths = malloc (pool->offsets_capacity * sizeof (uint32_t));
+  if (!pool->lengths)
+    _die ("%s: Unable to allocate pool->lengths (errno=%d)", __func__, errno);
+  for (i = 0U; i < pool->index.capacity; ++i)
+    if (!_scp_bucket_is_empty (pool->index.table + i))
+      pool->lengths[pool->index.table[i].id] = pool->index.table[i].len;
+}
+
+/**
+ * @brief Interns a batch of strings, interleaving their index lookups.
+ *
+ * Up to `SCP_BATCH_INFLIGHT` lookups are kept in flight, each one advancing by
+ * a single pointer chase (bucket, chained bucket, or arena key) per turn after
+ * prefetching its next target. Hence, the memory latency of one lookup is
+ * overlapped with the work of the others. Strings missing from the pool are
+ * inserted as soon as their lookup fails, and lookups that were in flight are
+ * restarted whenever that insertion rebuilt the index.
+ *
+ * The arena is reserved for the whole batch up front, so that every pointer
+ * stored in `out` stays valid until the next insertion outside the batch.
+ *
+ * @param pool The string pool to insert the strings into.
+ * @param strs The strings to intern.
+ * @param lens The maximum length of each string, or `NULL` if the strings are
+ * null-terminated.
+ * @param count The number of strings within the batch.
+ * @param out Receives the pooled copy of each string (may be `NULL`).
+ *
+ * @return The number of strings that were newly added to the pool.
+ */
+size_t
+scp_insert_strings (strpool_t *pool, const char *const *strs,
+                    const size_t *lens, size_t count, const char **out)
+{
+  struct _scp_batch_slot slots[SCP_BATCH_INFLIGHT], *slot;
+  scp_set_t *set = &pool->index;
+  scp_bucket_t *table, *bucket;
+  uint32_t capacity, before;
+  size_t i, n, next = 0UL, active = 0UL, reserve = 0UL, added = 0UL;
+  const char *s, *found;
+  bool keyed;
+
+  for (i = 0UL; i < count; ++i)
+    reserve += (lens ? strnlen (strs[i], lens[i]) : strlen (strs[i]))
+               + pool->alignment; /* Null terminator and padding */
+  scp_ensure_capacity (pool, pool->size + reserve);
+
+  for (i = 0UL; i < SCP_BATCH_INFLIGHT; ++i)
+    slots[i].stage = SCP_BATCH_IDLE;
+
+  table = set->table, capacity = set->capacity, keyed = set->keyed;
+  while (next < count || active > 0UL)
+    for (slot = slots; slot < slots + SCP_BATCH_INFLIGHT; ++slot)
+      {
+        if (slot->stage == SCP_BATCH_IDLE)
+          {
+            if (next == count)
+              continue;
+            slot->index = next++, active++;
+            slot->stage = SCP_BATCH_HASH;
+          }
+
+        s = strs[slot->index], n = lens ? lens[slot->index] : -1UL;
+        found = NULL;
+        switch (slot->stage)
+          {
+          case SCP_BATCH_HASH:
+            slot->len = n == -1UL ? strlen (s) : strnlen (s, n);
+            slot->hash = _scp_set_hash (set, s, slot->len, false);
+            slot->at = _scp_set_home (set, slot->hash), slot->probes = 1U;
+            if (!_scp_filter_contains (set, slot->hash))
+              break; /* The key is missing */
+            SCP_PREFETCH (set->table + slot->at);
+            slot->stage = SCP_BATCH_BUCKET;
+            continue;
+
+          case SCP_BATCH_BUCKET:
+            bucket = set->table + slot->at;
+            if (_scp_bucket_is_empty (bucket))
+              break; /* The key is missing */
+            if (bucket->hash == slot->hash && bucket->len == slot->len)
+              {
+                SCP_PREFETCH (set->arena + bucket->key);
+                slot->stage = SCP_BATCH_KEY;
+                continue;
+              }
+            if (bucket->next == -1U)
+              break;
+            slot->at = bucket->next, slot->probes++;
+            SCP_PREFETCH (set->table + slot->at);
+            continue;
+
+          case SCP_BATCH_KEY:
+            bucket = set->table + slot->at;
+            if (_scp_key_equals (bucket, set->arena, s, slot->len))
+              {
+                /* Unterminated views are left to the insertion path */
+                if (set->arena[bucket->key + bucket->len] != '\0')
+                  break;
+                found = set->arena + bucket->key;
+                if (pool->counts)
+                  _scp_count_hit (pool, bucket->id);
+                break;
+              }
+            if (bucket->next == -1U)
+              break;
+            slot->at = bucket->next, slot->probes++;
+            SCP_PREFETCH (set->table + slot->at);
+            slot->stage = SCP_BATCH_BUCKET;
+            continue;
+
+          default:
+            continue;
+          }
+
+        if (set->tuning != SCP_TUNING_FIXED)
+          set->probes += slot->probes, set->lookups++;
+
+        /* The lookup has either found its key or proven that it is missing,
+           in which case the regular insertion path takes over. */
+        if (!found)
+          {
+            before = set->size;
+            found = scp_insert_string_len (pool, s, n);
+            added += set->size - before;
+          }
+        if (out)
+          out[slot->index] = found;
+        slot->stage = SCP_BATCH_IDLE, active--;
+
+        /* Rebuilding the index invalidates the buckets held by the lookups
+           that are still in flight (and their hashes, if it became keyed) */
+        if (set->table != table || set->capacity != capacity
+            || set->keyed != keyed)
+          {
+            for (i = 0UL; i < SCP_BATCH_INFLIGHT; ++i)
+              if (slots[i].stage != SCP_BATCH_IDLE)
+                slots[i].stage = SCP_BATCH_HASH;
+            table = set->table, capacity = set->capacity, keyed = set->keyed;
+          }
+      }
+
+  return added;
 }
 
 inline uint32_t
@@ -162,19 +1306,97 @@ scp_size (strpool_t *pool)
 inline size_t
 scp_memory_usage (strpool_t *pool)
 {
-  size_t table_size = (sizeof (*pool->index.table) * pool->index.size);
-  return (pool->capacity + sizeof (*pool)) + table_size;
+  size_t table_size = (sizeof (*pool->index.table) * pool->index.capacity)
+                      + sizeof (*pool->offsets) * pool->offsets_capacity;
+  size_t filter_size = pool->index.filter_blocks * SCP_FILTER_BLOCK_WORDS
+                       * sizeof (*pool->index.filter);
+
+  if (pool->fingerprints)
+    table_size += sizeof (*pool->fingerprints) * pool->offsets_capacity
+                  + sizeof (uint32_t) * pool->fingerprint_capacity;
+  table_size += pool->payload_size * pool->offsets_capacity;
+  if (pool->lengths)
+    table_size += sizeof (uint32_t) * pool->offsets_capacity;
+  if (pool->counts)
+    table_size += (sizeof (uint64_t) + sizeof (uint32_t))
+                      * pool->offsets_capacity
+                  + sizeof (uint32_t) * pool->heap_capacity;
+  return (pool->capacity + sizeof (*pool)) + table_size + filter_size;
 }
 
 static void
 scp_ensure_capacity (strpool_t *pool, size_t min_capacity)
 {
-  if (min_capacity < pool->capacity)
+  min_capacity += SCP_ARENA_SLACK; /* Keep the slack readable */
+  if (min_capacity <= pool->capacity)
     return;
   size_t new_capacity = scp_new_capacity (pool, min_capacity);
   pool->pool = realloc (pool->pool, new_capacity);
   if (!pool->pool)
     _die ("%s: Unable to allocate pool->pool (errno=%d)", __func__, errno);
+
+  /* Everything past the last string stays zeroed, see `SCP_ARENA_SLACK` */
+  memset (pool->pool + pool->capacity, 0, new_capacity - pool->capacity);
+  pool->capacity = new_capacity;
+  pool->index.arena = pool->pool; /* Keys are relative to the arena */
+}
+
+static void
+scp_ensure_entries (strpool_t *pool, uint32_t min_entries)
+{
+  uint32_t new_capacity = pool->offsets_capacity;
+
+  if (min_entries <= pool->offsets_capacity)
+    return;
+  while (new_capacity < min_entries)
+    {
+      if (new_capacity > UINT32_MAX >> 1)
+        _die ("%s: String pool identifiers have overflowed.", __func__);
+      new_capacity <<= 1;
+    }
+
+  pool->offsets = realloc (pool->offsets, new_capacity * sizeof (size_t));
+  if (!pool->offsets)
+    _die ("%s: Unable to allocate pool->offsets (errno=%d)", __func__, errno);
+  pool->offsets_capacity = new_capacity;
+
+  if (pool->fingerprints)
+    {
+      pool->fingerprints = realloc (pool->fingerprints,
+                                    new_capacity * sizeof (uint64_t));
+      if (!pool->fingerprints)
+        _die ("%s: Unable to allocate pool->fingerprints (errno=%d)",
+              __func__, errno);
+    }
+
+  if (pool->lengths)
+    {
+      pool->lengths
+          = realloc (pool->lengths, new_capacity * sizeof (uint32_t));
+      if (!pool->lengths)
+        _die ("%s: Unable to allocate pool->lengths (errno=%d)", __func__,
+              errno);
+    }
+
+  if (pool->counts)
+    {
+      pool->counts
+          = realloc (pool->counts, new_capacity * sizeof (uint64_t));
+      pool->heap_at
+          = realloc (pool->heap_at, new_capacity * sizeof (uint32_t));
+      if (!pool->counts || !pool->heap_at)
+        _die ("%s: Unable to allocate occurrence counts (errno=%d)",
+              __func__, errno);
+    }
+
+  if (pool->payloads)
+    {
+      pool->payloads
+          = realloc (pool->payloads, new_capacity * pool->payload_size);
+      if (!pool->payloads)
+        _die ("%s: Unable to allocate pool->payloads (errno=%d)", __func__,
+              errno);
+    }
 }
 
 static size_t
@@ -205,6 +1427,17 @@ _scp_set_new ()
 static scp_set_t *
 _scp_set_init (scp_set_t *set)
 {
+  if (!set)
+    set = _scp_set_new ();
+
+  /* Rehashing reuses `_scp_set_init_custom(...)`, which therefore leaves the
+     arena and the tuning strategy untouched. */
+  set->arena = NULL;
+  set->tuning = SCP_TUNING_FIXED;
+  set->threads = 1U;
+  set->seed = _scp_random_seed (), set->keyed = false;
+  set->filter = NULL, set->filter_blocks = 0U, set->filter_bits = 0U;
+
   /* Prevent duplicate code by initalizing with library defaults */
   return _scp_set_init_custom (set, SCP_SET_DEFAULT_INITIAL_CAPACITY,
                                SCP_SET_DEFAULT_LOAD_FACTOR,
@@ -235,6 +1468,7 @@ _scp_set_init_custom (scp_set_t *set, uint32_t capacity, float load_factor,
   set->cellar_ratio = cellar_ratio;
   set->cellar_capacity = set->capacity * set->cellar_ratio;
   set->table_capacity = set->capacity - set->cellar_capacity;
+  set->probes = 0U, set->lookups = 0U, set->overflows = 0U;
   return set;
 }
 
@@ -243,6 +1477,8 @@ _scp_set_free (scp_set_t *set)
 {
   if (set->table)
     free (set->table);
+  if (set->filter)
+    free (set->filter);
 
   if (set->_dynamic)
     free (set);
@@ -264,7 +1500,7 @@ _scp_set_free (scp_set_t *set)
 static inline bool
 _scp_set_add (scp_set_t *set, const char *s)
 {
-  int rflags; /* Used to determine if a bucket was added */
+  int rflags = 0; /* Used to determine if a bucket was added */
   _scp_bucket_find (set, s, -1UL, true,
                     &rflags); /* Attempt to create the bucket */
   return rflags & 0x01;
@@ -273,14 +1509,14 @@ _scp_set_add (scp_set_t *set, const char *s)
 static inline bool
 _scp_set_contains (scp_set_t *set, const char *s, size_t n)
 {
-  return _scp_bucket_find (set, s, n, false, NULL) == NULL;
+  return _scp_bucket_find (set, s, n, false, NULL) != NULL;
 }
 
 static inline const char *
 _scp_set_get (scp_set_t *set, const char *s, size_t n)
 {
   scp_bucket_t *b = _scp_bucket_find (set, s, n, false, NULL);
-  return b ? b->key : NULL;
+  return b ? set->arena + b->key : NULL;
 }
 
 static inline bool
@@ -292,26 +1528,458 @@ _scp_set_is_empty (scp_set_t *set)
 static scp_set_t *
 _scp_set_rehash (scp_set_t *set)
 {
-  uint32_t i; /* Iterating through the old table */
-  scp_bucket_t *old_table = set->table;
+  if (set->tuning != SCP_TUNING_FIXED)
+    _scp_set_tune (set);
+
+  return _scp_set_resize (set, set->capacity << 1, false);
+}
+
+/**
+ * @brief Rebuilds the set into a table of the specified capacity.
+ *
+ * Growing the table reuses the hashes cached within the buckets, so that the
+ * arena isn't touched. Alternatively, every key may be rehashed with the
+ * set's current hash function, which allows the same routine to switch hash
+ * functions in place.
+ *
+ * @param set The hash set to rebuild.
+ * @param capacity The number of buckets of the new table.
+ * @param rehash_keys Whether the keys must be hashed again.
+ *
+ * @return The rebuilt set.
+ */
+static scp_set_t *
+_scp_set_resize (scp_set_t *set, uint32_t capacity, bool rehash_keys)
+{
+  uint32_t i, hash; /* Iterating through the old table */
+  scp_bucket_t *old_table = set->table, *chain;
   uint32_t old_capacity = set->capacity;
 
-  /* Reinitalize the set with an increased size... */
-  _scp_set_init_custom (set, set->capacity << 1, set->load_factor,
-                        set->cellar_ratio);
+  /* Reinitalize the set with the requested size... */
+  _scp_set_init_custom (set, capacity, set->load_factor, set->cellar_ratio);
+
+  /* The filter is rebuilt once, after the entries have been shifted */
+  free (set->filter);
+  set->filter = NULL, set->filter_blocks = 0U;
+
+  if (set->threads > 1U && old_capacity >= SCP_PARALLEL_MIN_CAPACITY)
+    {
+      _scp_set_resize_parallel (set, old_table, old_capacity, rehash_keys);
+      free (old_table);
+      _scp_filter_build (set);
+      return set;
+    }
 
-  /* Shift all the entries between the two tables */
+  /* Shift all the entries between the two tables. As keys are distinct, each
+     one is appended to its chain without any comparison. */
   for (i = 0; i < old_capacity; ++i)
     if (old_table[i].key)
-      _scp_set_add (set, old_table[i].key);
+      {
+        hash = rehash_keys ? _scp_set_hash (set,
+                                            set->arena + old_table[i].key,
+                                            old_table[i].len, true)
+                           : old_table[i].hash;
+
+        chain = set->table + _scp_set_home (set, hash);
+        while (chain->next != -1U)
+          chain = set->table + chain->next;
+
+        chain = _scp_bucket_link (set, chain, hash, old_table[i].key,
+                                  old_table[i].len);
+        if (!chain)
+          _die ("%s: No buckets could be found while rehashing.", __func__);
+        chain->id = old_table[i].id;
+      }
 
   free (old_table); /* Prevent memory leaks */
+  _scp_filter_build (set);
   return set;
 }
 
+/**
+ * @brief (Re)allocates the filter of a set and populates it from the table.
+ *
+ * The filter is sized for the number of entries the table may hold before it
+ * is rehashed, and populated from the hashes cached within the buckets, so
+ * the arena isn't touched.
+ *
+ * @param set The hash set whose filter should be rebuilt.
+ */
+static void
+_scp_filter_build (scp_set_t *set)
+{
+  uint64_t bits;
+  uint32_t i;
+
+  free (set->filter);
+  set->filter = NULL, set->filter_blocks = 0U;
+  if (!set->filter_bits)
+    return;
+
+  bits = (uint64_t)(set->capacity * set->load_factor + 1) * set->filter_bits;
+  set->filter_blocks = (bits + 32U * SCP_FILTER_BLOCK_WORDS - 1U)
+                       / (32U * SCP_FILTER_BLOCK_WORDS);
+  set->filter = calloc ((size_t)set->filter_blocks * SCP_FILTER_BLOCK_WORDS,
+                        sizeof (*set->filter));
+  if (!set->filter)
+    _die ("%s: Unable to allocate set->filter (errno=%d)", __func__, errno);
+
+  for (i = 0; i < set->capacity; ++i)
+    if (set->table[i].key)
+      _scp_filter_add (set, set->table[i].hash);
+}
+
+/* Odd constants that spread a hash over the eight words of a block */
+static const uint32_t _scp_filter_salts[SCP_FILTER_BLOCK_WORDS]
+    = { 0x47B6137BU, 0x44974D91U, 0x8824AD5BU, 0xA2B7289DU,
+        0x705495C7U, 0x2DF1424BU, 0x9EFC4947U, 0x5C6BFB31U };
+
+/**
+ * @brief Locates the filter block of a hash, and the hash used within it.
+ *
+ * The 32-bit hash of the index is stretched by a 64-bit finalizer so that
+ * the block and the bits within it are selected by independent bits.
+ */
+static inline uint32_t *
+_scp_filter_block (scp_set_t *set, uint32_t hash, uint32_t *inner)
+{
+  uint64_t h = ((uint64_t)hash << 32 | hash) ^ set->seed;
+
+  h ^= h >> 33, h *= 0xFF51AFD7ED558CCDULL;
+  h ^= h >> 33, h *= 0xC4CEB9FE1A85EC53ULL;
+  h ^= h >> 33;
+
+  *inner = (uint32_t)h;
+  return set->filter
+         + ((h >> 32) * set->filter_blocks >> 32) * SCP_FILTER_BLOCK_WORDS;
+}
+
+static inline void
+_scp_filter_add (scp_set_t *set, uint32_t hash)
+{
+  uint32_t i, inner, *block = _scp_filter_block (set, hash, &inner);
+
+  for (i = 0; i < SCP_FILTER_BLOCK_WORDS; ++i)
+    block[i] |= 1U << ((inner * _scp_filter_salts[i]) >> 27);
+}
+
+/**
+ * @brief Checks whether a hash may belong to the set, according to its filter.
+ *
+ * @return `false` if the hash definitely doesn't belong to the set, `true` if
+ * it may (or the set isn't filtered).
+ */
+static inline bool
+_scp_filter_contains (scp_set_t *set, uint32_t hash)
+{
+  uint32_t i, inner, *block, missing = 0U;
+
+  if (!set->filter)
+    return true;
+
+  block = _scp_filter_block (set, hash, &inner);
+  for (i = 0; i < SCP_FILTER_BLOCK_WORDS; ++i)
+    missing |= ~block[i] & (1U << ((inner * _scp_filter_salts[i]) >> 27));
+  return !missing;
+}
+
+/**
+ * @brief Moves the entries of the old table into the new one, in parallel.
+ *
+ * Since home buckets are ordered by hash (see `_scp_set_home(...)`), each
+ * slice of the old table mostly holds entries whose new home lies within the
+ * matching range of the new table. Hence, the workers first scan their own
+ * slice, storing local entries immediately and handing the others over to
+ * their owners, which store them in a second pass. Entries that found no
+ * room within their owner's buckets are finally stored serially.
+ *
+ * @param set The hash set, already reinitialized with its new table.
+ * @param old_table The previous table of the set.
+ * @param old_capacity The capacity of the previous table.
+ * @param rehash_keys Whether the keys must be hashed again.
+ */
+static void
+_scp_set_resize_parallel (scp_set_t *set, const scp_bucket_t *old_table,
+                          uint32_t old_capacity, bool rehash_keys)
+{
+  struct _scp_rehash_worker workers[SCP_MAX_THREADS], *worker;
+  pthread_t threads[SCP_MAX_THREADS];
+  uint32_t i, j, count = set->threads;
+  scp_bucket_t *chain;
+  size_t k;
+
+  for (i = 0U; i < count; ++i)
+    {
+      worker = workers + i;
+      *worker = (struct _scp_rehash_worker){ 0 };
+      worker->set = set, worker->old_table = old_table;
+      worker->rehash_keys = rehash_keys;
+      worker->index = i, worker->count = count, worker->workers = workers;
+
+      worker->from = (uint64_t)old_capacity * i / count;
+      worker->to = (uint64_t)old_capacity * (i + 1U) / count;
+      worker->lo = (uint64_t)set->table_capacity * i / count;
+      worker->hi = (uint64_t)set->table_capacity * (i + 1U) / count;
+      worker->cellar_lo
+          = set->table_capacity + (uint64_t)set->cellar_capacity * i / count;
+      worker->cellar_next = set->table_capacity
+                            + (uint64_t)set->cellar_capacity * (i + 1U) / count;
+
+      worker->outboxes = calloc (count, sizeof (*worker->outboxes));
+      if (!worker->outboxes)
+        _die ("%s: Unable to allocate outboxes (errno=%d)", __func__, errno);
+    }
+
+  /* Each pass runs the first worker on the calling thread */
+  for (i = 1U; i < count; ++i)
+    if (pthread_create (threads + i, NULL, _scp_rehash_scatter, workers + i))
+      _die ("%s: Unable to start rehash worker (errno=%d)", __func__, errno);
+  _scp_rehash_scatter (workers);
+  for (i = 1U; i < count; ++i)
+    pthread_join (threads[i], NULL);
+
+  for (i = 1U; i < count; ++i)
+    if (pthread_create (threads + i, NULL, _scp_rehash_gather, workers + i))
+      _die ("%s: Unable to start rehash worker (errno=%d)", __func__, errno);
+  _scp_rehash_gather (workers);
+  for (i = 1U; i < count; ++i)
+    pthread_join (threads[i], NULL);
+
+  for (i = 0U; i < count; ++i)
+    {
+      worker = workers + i;
+      set->size += worker->placed, set->overflows += worker->overflows;
+      for (j = 0U; j < count; ++j)
+        free (worker->outboxes[j].entries);
+      free (worker->outboxes);
+    }
+
+  for (i = 0U; i < count; ++i)
+    {
+      worker = workers + i;
+      for (k = 0UL; k < worker->leftovers.size; ++k)
+        {
+          chain = set->table
+                  + _scp_set_home (set, worker->leftovers.entries[k].hash);
+          while (chain->next != -1U)
+            chain = set->table + chain->next;
+
+          chain = _scp_bucket_link (set, chain,
+                                    worker->leftovers.entries[k].hash,
+                                    worker->leftovers.entries[k].key,
+                                    worker->leftovers.entries[k].len);
+          if (!chain)
+            _die ("%s: No buckets could be found while rehashing.", __func__);
+          chain->id = worker->leftovers.entries[k].id;
+        }
+      free (worker->leftovers.entries);
+    }
+}
+
+/* First pass: stores local entries, and hands over the others */
+static void *
+_scp_rehash_scatter (void *arg)
+{
+  struct _scp_rehash_worker *worker = arg;
+  scp_set_t *set = worker->set;
+  scp_bucket_t entry;
+  uint32_t i, owner;
+
+  for (i = worker->from; i < worker->to; ++i)
+    {
+      if (!worker->old_table[i].key)
+        continue;
+
+      entry = worker->old_table[i];
+      if (worker->rehash_keys)
+        entry.hash = _scp_set_hash (set, set->arena + entry.key, entry.len,
+                                    true);
+
+      owner = (uint64_t)_scp_set_home (set, entry.hash) * worker->count
+              / set->table_capacity;
+      while (worker->workers[owner].lo > _scp_set_home (set, entry.hash))
+        owner--; /* Correct the rounding of the division above */
+      while (worker->workers[owner].hi <= _scp_set_home (set, entry.hash))
+        owner++;
+
+      if (owner == worker->index)
+        _scp_rehash_place (worker, &entry);
+      else
+        _scp_outbox_push (worker->outboxes + owner, &entry);
+    }
+  return NULL;
+}
+
+/* Second pass: stores the entries handed over by the other workers */
+static void *
+_scp_rehash_gather (void *arg)
+{
+  struct _scp_rehash_worker *worker = arg;
+  struct _scp_rehash_outbox *outbox;
+  uint32_t i;
+  size_t k;
+
+  for (i = 0U; i < worker->count; ++i)
+    {
+      outbox = worker->workers[i].outboxes + worker->index;
+      for (k = 0UL; k < outbox->size; ++k)
+        _scp_rehash_place (worker, outbox->entries + k);
+    }
+  return NULL;
+}
+
+/**
+ * @brief Stores an entry within the buckets owned by a rehash worker.
+ *
+ * Mirrors `_scp_bucket_link(...)`, except that the cellar and the linear
+ * probing are confined to the worker's own buckets.
+ *
+ * @return `true` if the entry was stored, `false` if it was set aside for the
+ * final serial pass.
+ */
+static bool
+_scp_rehash_place (struct _scp_rehash_worker *worker,
+                   const scp_bucket_t *entry)
+{
+  scp_set_t *set = worker->set;
+  scp_bucket_t *chain = set->table + _scp_set_home (set, entry->hash);
+  scp_bucket_t *next = NULL;
+  uint32_t at, span = worker->hi - worker->lo;
+
+  while (chain->next != -1U)
+    chain = set->table + chain->next;
+
+  if (!_scp_bucket_is_empty (chain))
+    {
+      if (worker->cellar_next > worker->cellar_lo)
+        next = set->table + --worker->cellar_next;
+      else
+        {
+          worker->overflows++;
+          at = chain - set->table;
+          at = at < worker->lo || at >= worker->hi ? worker->lo : at;
+          for (; span > 0U; --span)
+            {
+              at = at + 1U < worker->hi ? at + 1U : worker->lo;
+              if (_scp_bucket_is_empty (set->table + at))
+                break;
+            }
+          if (!span)
+            {
+              _scp_outbox_push (&worker->leftovers, entry);
+              return false;
+            }
+          next = set->table + at;
+        }
+      chain->next = next - set->table;
+      chain = next;
+    }
+
+  chain->key = entry->key, chain->hash = entry->hash;
+  chain->len = entry->len, chain->id = entry->id;
+  worker->placed++;
+  return true;
+}
+
+static void
+_scp_outbox_push (struct _scp_rehash_outbox *outbox, const scp_bucket_t *entry)
+{
+  if (outbox->size == outbox->capacity)
+    {
+      outbox->capacity = outbox->capacity ? outbox->capacity << 1 : 256UL;
+      outbox->entries = realloc (outbox->entries,
+                                 outbox->capacity * sizeof (*entry));
+      if (!outbox->entries)
+        _die ("%s: Unable to allocate outbox (errno=%d)", __func__, errno);
+    }
+  outbox->entries[outbox->size++] = *entry;
+}
+
+/**
+ * @brief Retunes the load factor and cellar ratio ahead of a rehash.
+ *
+ * The average number of buckets visited per lookup is compared against the
+ * target of the selected strategy. `SCP_TUNING_MIN_LATENCY` lowers the load
+ * factor until chains are short, while `SCP_TUNING_MIN_MEMORY` raises it for
+ * as long as probes remain within budget. Independently, the cellar grows
+ * when insertions overflowed it, and shrinks when it was barely used.
+ *
+ * @param set The hash set about to be rehashed.
+ */
+static void
+_scp_set_tune (scp_set_t *set)
+{
+  double target, average;
+  float load_factor = set->load_factor, cellar_ratio = set->cellar_ratio;
+
+  if (set->lookups < SCP_TUNE_MIN_SAMPLES)
+    return; /* Too few samples to make an informed decision */
+
+  average = (double)set->probes / set->lookups;
+  if (set->tuning == SCP_TUNING_MIN_LATENCY)
+    {
+      target = SCP_TUNE_LATENCY_TARGET;
+      if (average > target)
+        load_factor -= 0.04f;
+      else if (average < target * 0.8
+               && load_factor < SCP_SET_DEFAULT_LOAD_FACTOR)
+        load_factor += 0.02f;
+    }
+  else
+    {
+      target = SCP_TUNE_MEMORY_TARGET;
+      if (average < target)
+        load_factor += 0.04f;
+      else
+        load_factor -= 0.02f;
+    }
+
+  if (set->overflows > 0U)
+    cellar_ratio += 0.02f;
+  else if (set->cellar_size < set->cellar_capacity / 2U)
+    cellar_ratio -= 0.02f;
+
+  if (load_factor < SCP_TUNE_MIN_LOAD_FACTOR)
+    load_factor = SCP_TUNE_MIN_LOAD_FACTOR;
+  if (load_factor > SCP_TUNE_MAX_LOAD_FACTOR)
+    load_factor = SCP_TUNE_MAX_LOAD_FACTOR;
+  if (cellar_ratio < SCP_TUNE_MIN_CELLAR_RATIO)
+    cellar_ratio = SCP_TUNE_MIN_CELLAR_RATIO;
+  if (cellar_ratio > SCP_TUNE_MAX_CELLAR_RATIO)
+    cellar_ratio = SCP_TUNE_MAX_CELLAR_RATIO;
+
+  set->load_factor = load_factor;
+  set->cellar_ratio = cellar_ratio;
+}
+
 static scp_bucket_t *
 _scp_bucket_find (scp_set_t *set, const char *s, size_t n, bool create,
                   int *rflags)
+{
+  if (!s) /* Loosely check for null pointer exceptions */
+    return NULL;
+
+  /* Cache string length, which is compared before any byte of the keys */
+  return _scp_bucket_find_len (set, s, n == -1UL ? strlen (s) : strnlen (s, n),
+                               create, rflags);
+}
+
+/**
+ * @brief Finds (or creates) the bucket of a key of exactly `len` bytes.
+ *
+ * @param set The hash set to search.
+ * @param s The key to search for; when `create` is set, it must already be
+ * stored within the arena.
+ * @param len The length of the key.
+ * @param create Whether to create the bucket if the key is missing.
+ * @param rflags Receives `0x01` if the bucket was created (may be `NULL`).
+ *
+ * @return The bucket of the key, or `NULL` if it is missing (and wasn't
+ * created).
+ */
+static scp_bucket_t *
+_scp_bucket_find_len (scp_set_t *set, const char *s, size_t len, bool create,
+                      int *rflags)
 {
   uint32_t hash;
   /* The variable `chain` is utilized primarily for searching for buckets
@@ -320,86 +1988,154 @@ _scp_bucket_find (scp_set_t *set, const char *s, size_t n, bool create,
      cases, during the initialization of the bucket, the `chain` bucket will be
      linked to the `next` bucket. */
   scp_bucket_t *chain, *next = NULL;
+  uint32_t probes = 1U; /* Buckets visited, sampled for adaptive tuning */
+  uint32_t collisions = 0U; /* Buckets sharing the full hash of the key */
 
   if (!set || !s) /* Loosely check for null pointer exceptions */
     return NULL;
 
   if (set->size > (set->capacity * set->load_factor) && create)
-    return _scp_bucket_find (_scp_set_rehash (set), s, create, n, rflags);
+    return _scp_bucket_find_len (_scp_set_rehash (set), s, len, create,
+                                 rflags);
 
-  hash = _scp_set_djb2 (s, n);
-  chain = set->table + (hash % set->table_capacity);
+  hash = _scp_set_hash (set, s, len, false);
+  if (!create && !_scp_filter_contains (set, hash))
+    return NULL; /* Rejected without touching the table */
+
+  chain = set->table + _scp_set_home (set, hash);
   if (!_scp_bucket_is_empty (chain))
     {
       while (true)
         {
           /* The requested key exists (and was found) */
-          if (hash == chain->hash && strncmp (s, chain->key, n) == 0)
+          if (hash == chain->hash
+              && _scp_key_equals (chain, set->arena, s, len))
             {
               if (rflags)
                 *rflags &= ~0x01;
+              if (set->tuning != SCP_TUNING_FIXED)
+                set->probes += probes, set->lookups++;
               return chain;
             }
+          collisions += hash == chain->hash;
 
           /* Iterate through the remainder of the chain */
           if (chain->next == -1U)
             break;
           chain = set->table + chain->next;
+          probes++;
         }
     }
 
+  if (set->tuning != SCP_TUNING_FIXED)
+    set->probes += probes, set->lookups++;
+
   /* The key doesn't exist in this set. */
   if (!create)
     return NULL;
 
+  /* Ordinary keys never build chains this long under a seeded hash; assume
+     that the keys were crafted to collide, and rebuild with a keyed hash. */
+  if (!set->keyed
+      && (probes > SCP_SET_MAX_CHAIN_LENGTH
+          || collisions > SCP_SET_MAX_COLLISIONS))
+    {
+      set->keyed = true;
+      return _scp_bucket_find_len (_scp_set_resize (set, set->capacity, true),
+                                   s, len, create, rflags);
+    }
+
+  /* The key may not be in the arena yet (see `_scp_pool_intern_len(...)`),
+     in which case the caller fixes its offset up */
+  next = _scp_bucket_link (set, chain, hash,
+                           (uintptr_t)s - (uintptr_t)set->arena, len);
+  if (!next)
+    {
+      if (set->size < set->capacity)
+        _die ("%s: size < capacity, yet no buckets could be found.", __func__);
+
+      /* Print a waring (shift to logging) */
+      fprintf (stderr, "%s: No buckets could be found (set->load_factor=%f)",
+               __func__, set->load_factor);
+
+      set->load_factor = SCP_SET_DEFAULT_LOAD_FACTOR;
+      return _scp_bucket_find_len (_scp_set_rehash (set), s, len, create,
+                                   rflags);
+    }
+
+  if (rflags)
+    *rflags |= 0x01;
+  return next;
+}
+
+/**
+ * @brief Stores a new key behind the last bucket of its chain.
+ *
+ * The key is stored within the chain's bucket if it is still empty, within
+ * the cellar if it has room left, and otherwise within the next empty bucket
+ * found by linearly probing the table.
+ *
+ * @param set The hash set to store the key into.
+ * @param chain The last bucket of the key's chain (or its empty home bucket).
+ * @param hash The hash of the key.
+ * @param key The offset of the key within the arena.
+ * @param len The length of the key.
+ *
+ * @return The bucket of the key, or `NULL` if the table has no empty bucket.
+ */
+static scp_bucket_t *
+_scp_bucket_link (scp_set_t *set, scp_bucket_t *chain, uint32_t hash,
+                  size_t key, size_t len)
+{
+  scp_bucket_t *next = NULL;
+  uint32_t probed;
+
   /* Special case: start of chain... */
   if (_scp_bucket_is_empty (chain))
     goto bucket_init;
 
-  /* Attempt to store the bucket in the cellar first. */
-  if (set->cellar_size < set->cellar_capacity)
+  /* Attempt to store the bucket in the cellar first. Parallel rehashing
+     leaves occupied buckets behind the cursor of the cellar, to be skipped. */
+  while (set->cellar_size < set->cellar_capacity)
     {
       /* (--set->cellar_size) -- maximal-munch principle */
       next = set->table + (set->capacity - (++set->cellar_size));
-      goto bucket_init;
+      if (_scp_bucket_is_empty (next))
+        goto bucket_init;
     }
 
+  set->overflows++; /* The cellar is exhausted, fall back to probing */
   next = chain; /* Start linearly proabing after the chain */
+  /* Chains ending within the cellar never come back around, so the probe is
+     bounded by the number of buckets of the table */
+  probed = 0U;
   do
     {
       /* idex = (pBucket[n] - pTable[0]) / sizeof(scp_bucket_t) */
       next = set->table + ((next - set->table + 1) % set->table_capacity);
     }
-  while (!_scp_bucket_is_empty (next) && chain != next);
-
-  if (chain == next)
-    {
-      if (set->size < set->capacity)
-        _die ("%s: size < capacity, yet no buckets could be found.", __func__);
-
-      /* Print a waring (shift to logging) */
-      fprintf (stderr, "%s: No buckets could be found (set->load_factor=%f)",
-               __func__, set->load_factor);
+  while (!_scp_bucket_is_empty (next) && ++probed < set->table_capacity);
 
-      set->load_factor = SCP_SET_DEFAULT_LOAD_FACTOR;
-      return _scp_bucket_find (_scp_set_rehash (set), s, create, n, rflags);
-    }
+  if (!_scp_bucket_is_empty (next))
+    return NULL;
 
 bucket_init:
   set->size++; /* Increase size for rehashing... */
+  if (set->filter)
+    _scp_filter_add (set, hash);
 
   if (next)
     { /* Only expand the chain if `next` is valid */
-      next->key = s, next->hash = hash;
+      next->key = key, next->hash = hash;
       chain->next = next - set->table;
     }
   else
     {
-      chain->key = s, chain->hash = hash;
+      chain->key = key, chain->hash = hash;
+      next = chain;
     }
-
-  if (rflags)
-    *rflags |= 0x01;
+  next->len = len;
+  next->id = set->size - 1U; /* Rehashing restores the previous identifier */
   return next;
 }
 
@@ -420,15 +2156,248 @@ _scp_bucket_is_empty (scp_bucket_t *bucket)
   return !bucket->key && bucket->next == -1U;
 }
 
+/**
+ * @brief Compares the key of a bucket against a string of known length.
+ *
+ * Lengths are compared first, from the bucket, so that the arena is only
+ * touched by keys of the right length. The bytes are then compared with
+ * `memcmp(...)`, which (unlike `strncmp(...)`) compares whole vectors without
+ * searching for terminators.
+ *
+ * @param bucket The bucket whose key should be compared.
+ * @param arena The arena holding the key.
+ * @param s The string to compare against.
+ * @param len The length of `s`.
+ *
+ * @return `true` if both strings are equal, `false` otherwise.
+ */
+static inline bool
+_scp_key_equals (const scp_bucket_t *bucket, const char *arena,
+                 const char *s, size_t len)
+{
+  return bucket->len == len && memcmp (arena + bucket->key, s, len) == 0;
+}
+
+/**
+ * @brief Maps a hash onto its home bucket, outside of the cellar.
+ *
+ * The hash is first scrambled (djb2 clusters similar keys within a narrow
+ * range of hashes), then scaled rather than reduced modulo the table, so
+ * that home buckets are ordered by scrambled hash. Consequently, a slice of
+ * a table maps onto the matching slice of the table it grows into, which is
+ * what allows rehash workers to own contiguous ranges of buckets.
+ *
+ * Source: https://lemire.me/blog/2016/06/27/a-fast-alternative-to-the-modulo-reduction/
+ */
+static inline uint32_t
+_scp_set_home (scp_set_t *set, uint32_t hash)
+{
+  hash ^= hash >> 16, hash *= 0x85EBCA6BU;
+  hash ^= hash >> 13, hash *= 0xC2B2AE35U;
+  hash ^= hash >> 16;
+  return ((uint64_t)hash * set->table_capacity) >> 32;
+}
+
+/**
+ * @brief Hashes a key with the hash function currently selected by the set.
+ *
+ * @param set The hash set whose hash function (and seed) should be used.
+ * @param s The key to hash.
+ * @param len The length of the key.
+ * @param padded Whether `s` lies within the arena, and may thus be overrun.
+ *
+ * @return The 32-bit hash of the key.
+ */
+static inline uint32_t
+_scp_set_hash (scp_set_t *set, const char *s, size_t len, bool padded)
+{
+  if (set->keyed)
+    return _scp_set_halfsiphash (s, len, set->seed);
+  return _scp_set_djb2 (s, len, (uint32_t)(set->seed ^ (set->seed >> 32)),
+                        padded);
+}
+
+/**
+ * @brief Gathers a random seed for the hash functions of a new set.
+ *
+ * The seed is read from `/dev/urandom` when it is available. Otherwise, the
+ * clock and the address space layout are mixed together, which is still
+ * sufficient to prevent collisions from being precomputed offline.
+ *
+ * @return A 64-bit random seed.
+ */
+static uint64_t
+_scp_random_seed (void)
+{
+  uint64_t seed = 0U;
+  FILE *urandom = fopen ("/dev/urandom", "rb");
+
+  if (urandom)
+    {
+      if (fread (&seed, sizeof (seed), 1, urandom) != 1)
+        seed = 0U;
+      fclose (urandom);
+    }
+
+  if (!seed)
+    {
+      seed = (uint64_t)time (NULL) ^ ((uint64_t)clock () << 32);
+      seed ^= (uint64_t)(uintptr_t)&seed * 0x9E3779B97F4A7C15ULL;
+    }
+  return seed;
+}
+
+/* Powers of 33 (modulo 2^32), weighting the bytes of a word for djb2. The
+   trailing zeroes discard the bytes past the end of a partial word. */
+static const uint32_t _scp_djb2_powers[16]
+    = { 0xEC41D4E1U, 0x4CFA3CC1U, 0x025528A1U, 0x00121881U,
+        0x00008C61U, 0x00000441U, 0x00000021U, 0x00000001U,
+        0x0U,        0x0U,        0x0U,        0x0U,
+        0x0U,        0x0U,        0x0U,        0x0U };
+
+/*
+ * Seeding djb2 randomizes the placement of keys, although keys of equal length
+ * that collide do so under every seed. Such floods are instead caught by the
+ * chain length checks of `_scp_bucket_find(...)`.
+ *
+ * Rather than folding one byte at a time (hash * 33 + c), eight bytes are
+ * folded at once: hash * 33^8 + c0 * 33^7 + ... + c7, whose products are
+ * independent of one another. The final partial word is folded the same way,
+ * with zero weights past the end of the key; keys within the (padded) arena
+ * are loaded as a whole word, others through a zeroed copy.
+ */
 static uint32_t
-_scp_set_djb2 (const char *s, size_t n)
+_scp_set_djb2 (const char *s, size_t len, uint32_t seed, bool padded)
 {
-  uint32_t hash = 5381U;
-  char c; /* Used to store the current character */
+  uint32_t hash = 5381U ^ seed, sum;
+  const uint32_t *weights;
+  char word[8]; /* Sign extension of `char` matches the bytewise djb2 */
+  size_t i, j, tail = len & 7UL;
+
   if (!s) /* Defend against pesky null pointers */
     return 0U;
 
-  for (size_t i = 0UL; (c = *s++) && i < n; ++i)
-    hash = ((hash << 5) + hash) + c; /* hash * 33 + c */
+  for (i = 0UL; i + 8UL <= len; i += 8UL)
+    {
+      memcpy (word, s + i, 8);
+      for (sum = 0U, j = 0UL; j < 8UL; ++j)
+        sum += (uint32_t)word[j] * _scp_djb2_powers[j];
+      hash = hash * 0x747C7101U + sum; /* hash * 33^8 + ... */
+    }
+
+  if (tail)
+    {
+      if (padded)
+        memcpy (word, s + i, 8);
+      else
+        memset (word, 0, 8), memcpy (word, s + i, tail);
+
+      weights = _scp_djb2_powers + (8UL - tail);
+      for (sum = 0U, j = 0UL; j < 8UL; ++j)
+        sum += (uint32_t)word[j] * weights[j];
+      hash = hash * _scp_djb2_powers[7UL - tail] + sum; /* hash * 33^tail */
+    }
   return hash;
 }
+
+#define _SCP_ROTL32(x, b) (uint32_t)(((x) << (b)) | ((x) >> (32 - (b))))
+#define _SCP_SIPROUND                                                         \
+  do                                                                          \
+    {                                                                         \
+      v0 += v1, v1 = _SCP_ROTL32 (v1, 5), v1 ^= v0, v0 = _SCP_ROTL32 (v0, 16); \
+      v2 += v3, v3 = _SCP_ROTL32 (v3, 8), v3 ^= v2;                           \
+      v0 += v3, v3 = _SCP_ROTL32 (v3, 7), v3 ^= v0;                           \
+      v2 += v1, v1 = _SCP_ROTL32 (v1, 13), v1 ^= v2, v2 = _SCP_ROTL32 (v2, 16); \
+    }                                                                         \
+  while (0)
+
+/**
+ * @brief Computes HalfSipHash-2-4 of a key with a 64-bit secret.
+ *
+ * @param s The key to hash.
+ * @param len The length of the key.
+ * @param key The secret key, normally the seed of the set.
+ *
+ * @return The 32-bit keyed hash of the key.
+ */
+static uint32_t
+_scp_set_halfsiphash (const char *s, size_t len, uint64_t key)
+{
+  const unsigned char *in = (const unsigned char *)s;
+  size_t i;
+  uint32_t k0 = (uint32_t)key, k1 = (uint32_t)(key >> 32);
+  uint32_t v0 = k0, v1 = k1, v2 = 0x6C796765U ^ k0, v3 = 0x74656462U ^ k1;
+  uint32_t m, b = (uint32_t)len << 24;
+
+  for (i = 0UL; i + 4UL <= len; i += 4UL)
+    {
+      m = (uint32_t)in[i] | (uint32_t)in[i + 1] << 8
+          | (uint32_t)in[i + 2] << 16 | (uint32_t)in[i + 3] << 24;
+      v3 ^= m;
+      _SCP_SIPROUND;
+      _SCP_SIPROUND;
+      v0 ^= m;
+    }
+
+  switch (len & 3UL) /* Fold the remaining bytes into the final block */
+    {
+    case 3:
+      b |= (uint32_t)in[i + 2] << 16;
+      /* fall through */
+    case 2:
+      b |= (uint32_t)in[i + 1] << 8;
+      /* fall through */
+    case 1:
+      b |= (uint32_t)in[i];
+      break;
+    }
+
+  v3 ^= b;
+  _SCP_SIPROUND;
+  _SCP_SIPROUND;
+  v0 ^= b;
+
+  v2 ^= 0xFFU;
+  _SCP_SIPROUND;
+  _SCP_SIPROUND;
+  _SCP_SIPROUND;
+  _SCP_SIPROUND;
+  return v1 ^ v3;
+}
+
+/**
+ * @brief Computes a 64-bit hash of a byte string, independently of the pool.
+ *
+ * The hash only depends on the bytes, their length and the seed (words are
+ * read in little-endian order), so it is stable across processes, platforms
+ * and releases. It backs the persistent structures of the library, such as
+ * the perfect hash functions of frozen pools.
+ *
+ * @param s The bytes to hash.
+ * @param n The number of bytes to hash.
+ * @param seed An arbitrary seed.
+ *
+ * @return The 64-bit hash of the bytes.
+ */
+uint64_t
+scp_hash64 (const void *s, size_t n, uint64_t seed)
+{
+  const unsigned char *in = s;
+  uint64_t h = seed ^ (n * 0x9E3779B97F4A7C15ULL), w;
+  size_t i, j;
+
+  for (i = 0UL; i < n; i += 8UL)
+    {
+      for (w = 0U, j = 0UL; j < 8UL && i + j < n; ++j)
+        w |= (uint64_t)in[i + j] << (8U * j);
+
+      w *= 0x87C37B91114253D5ULL, w = (w << 31) | (w >> 33);
+      w *= 0x4CF5AD432745937FULL;
+      h ^= w, h = (h << 27) | (h >> 37);
+      h = h * 5U + 0x52DCE729U;
+    }
+
+  h ^= h >> 33, h *= 0xFF51AFD7ED558CCDULL;
+  h ^= h >> 33, h *= 0xC4CEB9FE1A85EC53ULL;
+  return h ^ (h >> 33);
+}
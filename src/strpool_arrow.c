@@ -0,0 +1,346 @@
+/*
+ * strpool_arrow.c - [description]
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "strpool_arrow.h"
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Strings of at most 12 bytes are stored within their view */
+#define SCP_ARROW_VIEW_INLINE 12U
+
+/* Arena bytes addressed by each variadic buffer of an exported view array.
+   View offsets are signed 32-bit integers, so the arena is exposed through
+   overlapping buffers starting every 1 GiB. */
+#define SCP_ARROW_BUFFER_SHIFT 30U
+
+/* Layout of a single view of a `string_view` (or `binary_view`) array.
+   Source: https://arrow.apache.org/docs/format/Columnar.html */
+union _scp_arrow_view
+{
+  struct
+  {
+    int32_t length;
+    char data[SCP_ARROW_VIEW_INLINE];
+  } inlined;
+  struct
+  {
+    int32_t length;
+    char prefix[4];
+    int32_t buffer;
+    int32_t offset;
+  } ref;
+};
+
+/* Memory owned by an exported (values) array */
+struct _scp_arrow_private
+{
+  union _scp_arrow_view *views;
+  const void **buffers;
+  int64_t *sizes;
+};
+
+static bool _scp_arrow_export_values (const scp_frozen_t *frozen,
+                                      bool binary,
+                                      struct ArrowSchema *schema,
+                                      struct ArrowArray *array);
+static void _scp_arrow_release_schema (struct ArrowSchema *schema);
+static void _scp_arrow_release_array (struct ArrowArray *array);
+
+/**
+ * @brief Terminates the program execution due to a critical exception.
+ *
+ * @param fmt Format string for the error message, followed by optional
+ * arguments.
+ * @param ... Optional arguments corresponding to the format string.
+ */
+static void
+_die (const char *fmt, ...)
+{
+  va_list arg;
+
+  va_start (arg, fmt);
+  vfprintf (stderr, fmt, arg);
+  fprintf (stderr, "\n");
+  va_end (arg);
+
+  exit (EXIT_FAILURE);
+}
+
+/**
+ * @brief Interns every value of an Arrow string (or binary) array.
+ *
+ * Values are read straight from the buffers of the array: no intermediate
+ * C strings are built, and their lengths are taken from the offsets (or the
+ * views) rather than measured. Supported formats are `u`/`z` (32-bit
+ * offsets), `U`/`Z` (64-bit offsets) and `vu`/`vz` (views).
+ *
+ * @param pool The string pool to insert the values into.
+ * @param schema The schema of the array.
+ * @param array The array whose values should be interned.
+ * @param indices Receives the identifier of each value, suitable as the
+ * indices of a dictionary array; null values receive `-1` (that is,
+ * `SCP_INVALID_ID`), which `scp_arrow_export_dictionary(...)` turns back
+ * into nulls.
+ *
+ * @return `true` on success, `false` if the format isn't supported or if the
+ * identifiers overflow 32-bit signed indices.
+ */
+bool
+scp_arrow_import (strpool_t *pool, const struct ArrowSchema *schema,
+                  const struct ArrowArray *array, int32_t *indices)
+{
+  const uint8_t *validity = array->buffers[0];
+  const union _scp_arrow_view *view;
+  const char *data;
+  int64_t i, at, begin, end;
+  uint32_t id;
+  bool views = schema->format[0] == 'v', wide = false;
+
+  if (views)
+    {
+      if ((schema->format[1] != 'u' && schema->format[1] != 'z')
+          || schema->format[2])
+        return false;
+    }
+  else
+    {
+      if (!strchr ("uzUZ", schema->format[0]) || schema->format[1])
+        return false;
+      wide = schema->format[0] == 'U' || schema->format[0] == 'Z';
+    }
+
+  for (i = 0; i < array->length; ++i)
+    {
+      at = array->offset + i;
+      if (validity && !(validity[at >> 3] >> (at & 7) & 1U))
+        {
+          indices[i] = (int32_t)SCP_INVALID_ID;
+          continue;
+        }
+
+      if (views)
+        {
+          view = (const union _scp_arrow_view *)array->buffers[1] + at;
+          if (view->inlined.length <= (int32_t)SCP_ARROW_VIEW_INLINE)
+            data = view->inlined.data;
+          else
+            data = (const char *)array->buffers[2 + view->ref.buffer]
+                   + view->ref.offset;
+          id = scp_insert_bytes (pool, data, view->inlined.length);
+        }
+      else
+        {
+          if (wide)
+            begin = ((const int64_t *)array->buffers[1])[at],
+            end = ((const int64_t *)array->buffers[1])[at + 1];
+          else
+            begin = ((const int32_t *)array->buffers[1])[at],
+            end = ((const int32_t *)array->buffers[1])[at + 1];
+          id = scp_insert_bytes (pool, (const char *)array->buffers[2] + begin,
+                                 end - begin);
+        }
+
+      if (id > INT32_MAX)
+        return false;
+      indices[i] = id;
+    }
+
+  return true;
+}
+
+/**
+ * @brief Exports the strings of a frozen pool as an Arrow `string_view` (or
+ * `binary_view`) array, whose `i`th value is the string of identifier `i`.
+ *
+ * The arena of the frozen pool is exposed as the data buffer(s), without any
+ * copy; only the 16-byte views are allocated. Views are used rather than
+ * offsets since pooled strings are separated by their null terminators.
+ *
+ * @param frozen The frozen pool to export.
+ * @param binary Whether to export `binary_view` values (`vz`), as
+ * `string_view` values (`vu`) must be valid UTF-8, which the pool doesn't
+ * check (strings imported from binary columns, in particular, may not be).
+ * @param schema Receives the schema of the array.
+ * @param array Receives the array.
+ *
+ * @return `true` on success, `false` if the pool doesn't fit Arrow's limits.
+ */
+bool
+scp_arrow_export (const scp_frozen_t *frozen, bool binary,
+                  struct ArrowSchema *schema, struct ArrowArray *array)
+{
+  return _scp_arrow_export_values (frozen, binary, schema, array);
+}
+
+/**
+ * @brief Exports a column of identifiers as an Arrow dictionary array, whose
+ * dictionary holds the strings of a frozen pool.
+ *
+ * @param frozen The frozen pool (the dictionary).
+ * @param binary Whether the dictionary holds binary values, see
+ * `scp_arrow_export(...)`.
+ * @param indices The identifiers of the column, referenced without any copy;
+ * negative identifiers (as imported from nulls) are exported as nulls.
+ * @param length The number of identifiers within the column.
+ * @param schema Receives the schema of the dictionary array.
+ * @param array Receives the dictionary array.
+ *
+ * @return `true` on success, `false` if the pool doesn't fit Arrow's limits.
+ */
+bool
+scp_arrow_export_dictionary (const scp_frozen_t *frozen, bool binary,
+                             const int32_t *indices, int64_t length,
+                             struct ArrowSchema *schema,
+                             struct ArrowArray *array)
+{
+  struct ArrowSchema *values_schema = malloc (sizeof (*values_schema));
+  struct ArrowArray *values = malloc (sizeof (*values));
+  const void **buffers = malloc (2 * sizeof (*buffers));
+  uint8_t *validity = NULL;
+  int64_t i, null_count = 0;
+
+  if (!values_schema || !values || !buffers)
+    _die ("%s: Unable to allocate dictionary (errno=%d)", __func__, errno);
+
+  if (!_scp_arrow_export_values (frozen, binary, values_schema, values))
+    {
+      free (values_schema), free (values), free (buffers);
+      return false;
+    }
+
+  /* The validity bitmap is only built if the column holds nulls */
+  for (i = 0; i < length; ++i)
+    if (indices[i] < 0)
+      {
+        if (!validity)
+          {
+            validity = malloc ((length + 7) / 8);
+            if (!validity)
+              _die ("%s: Unable to allocate validity (errno=%d)", __func__,
+                    errno);
+            memset (validity, 0xFF, (length + 7) / 8);
+          }
+        validity[i >> 3] &= ~(1U << (i & 7)), null_count++;
+      }
+
+  /* Consumers only expect nulls within nullable fields */
+  *schema = (struct ArrowSchema){ .format = "i",
+                                  .flags = null_count ? ARROW_FLAG_NULLABLE
+                                                      : 0,
+                                  .dictionary = values_schema,
+                                  .release = _scp_arrow_release_schema };
+
+  buffers[0] = validity, buffers[1] = indices;
+  *array = (struct ArrowArray){ .length = length,
+                                .null_count = null_count,
+                                .n_buffers = 2,
+                                .buffers = buffers,
+                                .dictionary = values,
+                                .release = _scp_arrow_release_array };
+  return true;
+}
+
+static bool
+_scp_arrow_export_values (const scp_frozen_t *frozen, bool binary,
+                          struct ArrowSchema *schema, struct ArrowArray *array)
+{
+  struct _scp_arrow_private *private;
+  union _scp_arrow_view *view;
+  uint64_t arena_size = frozen->offsets[frozen->size], at;
+  size_t len, buffer_count = (arena_size >> SCP_ARROW_BUFFER_SHIFT) + 1U, i;
+  uint32_t id;
+
+  if (frozen->size > INT32_MAX)
+    return false;
+
+  private = malloc (sizeof (*private));
+  if (!private)
+    _die ("%s: Unable to allocate private data (errno=%d)", __func__, errno);
+  private->views = calloc (frozen->size + 1ULL, sizeof (*private->views));
+  private->buffers = malloc ((buffer_count + 3U) * sizeof (void *));
+  private->sizes = malloc (buffer_count * sizeof (int64_t));
+  if (!private->views || !private->buffers || !private->sizes)
+    _die ("%s: Unable to allocate views (errno=%d)", __func__, errno);
+
+  for (id = 0U; id < frozen->size; ++id)
+    {
+      view = private->views + id;
+      at = frozen->offsets[id], len = scp_frozen_length (frozen, id);
+      if (len > INT32_MAX)
+        {
+          free (private->views), free (private->buffers);
+          free (private->sizes), free (private);
+          return false;
+        }
+
+      view->inlined.length = len;
+      if (len <= SCP_ARROW_VIEW_INLINE)
+        memcpy (view->inlined.data, frozen->arena + at, len);
+      else
+        {
+          memcpy (view->ref.prefix, frozen->arena + at, 4);
+          view->ref.buffer = at >> SCP_ARROW_BUFFER_SHIFT;
+          view->ref.offset = at - ((uint64_t)view->ref.buffer
+                                   << SCP_ARROW_BUFFER_SHIFT);
+        }
+    }
+
+  /* validity, views, variadic data buffers, and their sizes */
+  private->buffers[0] = NULL, private->buffers[1] = private->views;
+  for (i = 0U; i < buffer_count; ++i)
+    {
+      private->buffers[2 + i] = frozen->arena + (i << SCP_ARROW_BUFFER_SHIFT);
+      private->sizes[i] = arena_size - (i << SCP_ARROW_BUFFER_SHIFT);
+    }
+  private->buffers[2 + buffer_count] = private->sizes;
+
+  *schema = (struct ArrowSchema){ .format = binary ? "vz" : "vu",
+                                  .release = _scp_arrow_release_schema };
+  *array = (struct ArrowArray){ .length = frozen->size,
+                                .n_buffers = buffer_count + 3U,
+                                .buffers = private->buffers,
+                                .release = _scp_arrow_release_array,
+                                .private_data = private };
+  return true;
+}
+
+static void
+_scp_arrow_release_schema (struct ArrowSchema *schema)
+{
+  if (schema->dictionary)
+    {
+      if (schema->dictionary->release)
+        schema->dictionary->release (schema->dictionary);
+      free (schema->dictionary);
+    }
+  schema->release = NULL;
+}
+
+static void
+_scp_arrow_release_array (struct ArrowArray *array)
+{
+  struct _scp_arrow_private *private = array->private_data;
+
+  if (array->dictionary)
+    {
+      if (array->dictionary->release)
+        array->dictionary->release (array->dictionary);
+      free (array->dictionary);
+      /* The validity bitmap is owned, whereas the indices are referenced */
+      free ((void *)array->buffers[0]), free (array->buffers);
+    }
+
+  if (private)
+    {
+      free (private->views), free (private->buffers);
+      free (private->sizes), free (private);
+    }
+  array->release = NULL;
+}
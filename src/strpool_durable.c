@@ -0,0 +1,665 @@
+/*
+ * strpool_durable.c - [description]
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#define _GNU_SOURCE /* mremap(...) */
+
+#include "strpool_durable.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SCP_DURABLE_MAGIC "SCPDUR\0\1"
+#define SCP_DURABLE_INDEX_MAGIC "SCPDIX\0\1"
+#define SCP_DURABLE_SEED 0xD0AB1E5EED5CF00DULL
+
+#define SCP_DURABLE_HEADER_SIZE 4096UL /* The arena starts on its own page */
+#define SCP_DURABLE_INITIAL_ARENA (1UL << 20)
+#define SCP_DURABLE_INITIAL_IDS 4096U
+
+/*
+ * Header of the data file. The committed size and arena size are the only
+ * fields ever rewritten; they share a single sector, and the arena size is
+ * stored first, so that a torn publication never exposes a partial string.
+ */
+struct _scp_durable_header
+{
+  char magic[8];
+  uint64_t seed;
+  uint64_t arena_size; /* Bytes of the arena covered by the commit */
+  uint64_t size;       /* Strings covered by the commit */
+};
+
+/*
+ * Header of the index file, followed by `id_capacity` arena offsets and by
+ * `slot_count` slots. A slot holds its identifier plus one (zero marks an
+ * empty slot, so that freshly truncated files are empty tables) in its low
+ * half, and the high half of the hash of its string in its high half. Only
+ * that half picks the first slot probed, so that the table may be grown
+ * without hashing any string again.
+ */
+struct _scp_durable_index_header
+{
+  char magic[8];
+  uint32_t id_capacity;
+  uint32_t slot_count;
+  uint64_t seed;
+  uint64_t _reserved;
+};
+
+/*
+ * Each string is stored as a record: its length, its bytes and a null
+ * terminator, padded to 8 bytes so that the next length stays aligned.
+ */
+#define SCP_DURABLE_RECORD_SIZE(len) ((sizeof (uint32_t) + (len) + 8UL) & ~7UL)
+
+static bool _scp_durable_map_data (scp_durable_t *pool);
+static bool _scp_durable_grow_data (scp_durable_t *pool, uint64_t min_size);
+static bool _scp_durable_open_index (scp_durable_t *pool);
+static bool _scp_durable_reindex (scp_durable_t *pool, uint32_t id_capacity);
+static void _scp_durable_link (uint64_t *slots, uint32_t slot_mask,
+                               uint64_t hash, uint32_t id);
+static void _scp_durable_relink (uint64_t *slots, uint32_t slot_mask,
+                                 const uint64_t *old_slots,
+                                 uint32_t old_slot_mask, uint32_t count);
+static bool _scp_durable_flush (void *base, size_t from, size_t to);
+static void _scp_durable_publish (scp_durable_t *pool);
+static void _scp_durable_release (scp_durable_t *pool);
+static char *_scp_durable_index_path (const char *path, const char *suffix);
+
+static inline struct _scp_durable_header *
+_scp_durable_header (scp_durable_t *pool)
+{
+  return (struct _scp_durable_header *)pool->data;
+}
+
+static inline char *
+_scp_durable_record (scp_durable_t *pool, uint32_t id)
+{
+  return pool->data + SCP_DURABLE_HEADER_SIZE + pool->offsets[id];
+}
+
+/**
+ * @brief Terminates the program execution due to a critical exception.
+ *
+ * @param fmt Format string for the error message, followed by optional
+ * arguments.
+ * @param ... Optional arguments corresponding to the format string.
+ */
+static void
+_die (const char *fmt, ...)
+{
+  va_list arg;
+
+  va_start (arg, fmt);
+  vfprintf (stderr, fmt, arg);
+  fprintf (stderr, "\n");
+  va_end (arg);
+
+  exit (EXIT_FAILURE);
+}
+
+/**
+ * @brief Opens (or creates) a durable pool stored at `path`.
+ *
+ * Both files are mapped as they are: no string is read until it is looked
+ * up. Strings inserted after the last commit of a previous session are
+ * discarded. Should the index be missing or damaged, it is rebuilt from the
+ * arena, which is the only authoritative part of the pool.
+ *
+ * @param path The path of the data file; the index lives at `path.idx`.
+ * @param sync When insertions are flushed to stable storage.
+ *
+ * @return The durable pool, to be released with `scp_durable_close(...)`,
+ * or `NULL` (with `errno` set) if the files couldn't be opened or `path`
+ * isn't a durable pool. A pool is opened by a single process at a time:
+ * `errno` is set to `EWOULDBLOCK` while another one holds it.
+ */
+scp_durable_t *
+scp_durable_open (const char *path, scp_sync_t sync)
+{
+  struct _scp_durable_header *header;
+  scp_durable_t *pool = calloc (1, sizeof (*pool));
+  int error;
+
+  if (!pool)
+    _die ("%s: Unable to allocate durable pool (errno=%d)", __func__, errno);
+  pool->sync = sync, pool->index_fd = -1;
+
+  pool->path = strdup (path);
+  if (!pool->path)
+    _die ("%s: Unable to allocate durable pool (errno=%d)", __func__, errno);
+
+  /* Two processes mutating the same mappings would corrupt the pool */
+  pool->fd = open (path, O_RDWR | O_CREAT, 0644);
+  if (pool->fd < 0 || flock (pool->fd, LOCK_EX | LOCK_NB) < 0
+      || !_scp_durable_map_data (pool))
+    goto fail;
+
+  header = _scp_durable_header (pool);
+  pool->size = pool->committed = header->size;
+  pool->arena_size = pool->committed_arena_size = header->arena_size;
+  if (pool->arena_size > pool->data_length - SCP_DURABLE_HEADER_SIZE)
+    {
+      errno = EINVAL;
+      goto fail;
+    }
+
+  if (!_scp_durable_open_index (pool))
+    goto fail;
+  return pool;
+
+fail:
+  error = errno;
+  _scp_durable_release (pool);
+  errno = error;
+  return NULL;
+}
+
+/**
+ * @brief Commits and closes a durable pool.
+ *
+ * @return `true` if the final commit succeeded. The pool is released
+ * regardless.
+ */
+bool
+scp_durable_close (scp_durable_t *pool)
+{
+  bool committed = pool->sync == SCP_SYNC_NONE ? true
+                                               : scp_durable_commit (pool);
+
+  _scp_durable_release (pool);
+  return committed;
+}
+
+/**
+ * @brief Inserts a string within a durable pool.
+ *
+ * The string is appended to the arena before its index entry is written, and
+ * both are published according to the synchronization policy of the pool.
+ *
+ * @param pool The durable pool.
+ * @param s The string to insert.
+ * @param n The maximum length of `s`, or `-1UL` if it is null-terminated.
+ *
+ * @return The identifier of the string, or `SCP_INVALID_ID` (with `errno`
+ * set) if either file couldn't be grown, or the commit failed.
+ */
+uint32_t
+scp_durable_insert (scp_durable_t *pool, const char *s, size_t n)
+{
+  size_t len = n == -1UL ? strlen (s) : strnlen (s, n);
+  uint64_t hash, record = SCP_DURABLE_RECORD_SIZE (len);
+  uint32_t id = scp_durable_lookup (pool, s, len), len32 = len;
+  char *at;
+
+  if (id != SCP_INVALID_ID)
+    return id;
+  if (len > UINT32_MAX || pool->size == SCP_INVALID_ID - 1U)
+    {
+      errno = EOVERFLOW;
+      return SCP_INVALID_ID;
+    }
+
+  /* Keep the table at most half full */
+  if (pool->size == pool->id_capacity)
+    if (!_scp_durable_reindex (pool, pool->id_capacity << 1))
+      return SCP_INVALID_ID;
+  if (!_scp_durable_grow_data (pool, pool->arena_size + record))
+    return SCP_INVALID_ID;
+
+  /* The record lies past the committed arena, so it may be written freely */
+  at = pool->data + SCP_DURABLE_HEADER_SIZE + pool->arena_size;
+  memcpy (at, &len32, sizeof (len32));
+  memcpy (at + sizeof (len32), s, len);
+  at[sizeof (len32) + len] = '\0';
+
+  id = pool->size;
+  hash = scp_hash64 (s, len, SCP_DURABLE_SEED);
+  pool->offsets[id] = pool->arena_size;
+  _scp_durable_link (pool->slots, pool->slot_mask, hash, id);
+  pool->arena_size += record, pool->size++;
+
+  if (pool->sync == SCP_SYNC_NONE)
+    _scp_durable_publish (pool);
+  else if (pool->sync == SCP_SYNC_ALWAYS && !scp_durable_commit (pool))
+    return SCP_INVALID_ID;
+  return id;
+}
+
+/**
+ * @brief Retrieves the identifier of a string within a durable pool.
+ *
+ * @param pool The durable pool to search.
+ * @param s The string to search for.
+ * @param n The maximum length of `s`, or `-1UL` if it is null-terminated.
+ *
+ * @return The identifier of the string, or `SCP_INVALID_ID` if the pool
+ * doesn't contain it.
+ */
+uint32_t
+scp_durable_lookup (scp_durable_t *pool, const char *s, size_t n)
+{
+  size_t len = n == -1UL ? strlen (s) : strnlen (s, n);
+  uint64_t hash = scp_hash64 (s, len, SCP_DURABLE_SEED), slot;
+  uint32_t at = (hash >> 32) & pool->slot_mask, id, stored;
+  const char *record;
+
+  while ((slot = pool->slots[at]))
+    {
+      id = (uint32_t)slot - 1U;
+      if ((slot >> 32) == (hash >> 32))
+        {
+          record = _scp_durable_record (pool, id);
+          memcpy (&stored, record, sizeof (stored));
+          if (stored == len && !memcmp (record + sizeof (stored), s, len))
+            return id;
+        }
+      at = (at + 1U) & pool->slot_mask;
+    }
+  return SCP_INVALID_ID;
+}
+
+/**
+ * @brief Retrieves a string of a durable pool from its identifier.
+ *
+ * As the data file is remapped while it grows, the string is only valid
+ * until the next insertion.
+ *
+ * @return The null-terminated string, or `NULL` if `id` is out of range.
+ */
+const char *
+scp_durable_string (scp_durable_t *pool, uint32_t id)
+{
+  if (id >= pool->size)
+    return NULL;
+  return _scp_durable_record (pool, id) + sizeof (uint32_t);
+}
+
+/**
+ * @brief Retrieves the length of a string of a durable pool.
+ *
+ * @return The length of the string, or zero if `id` is out of range.
+ */
+size_t
+scp_durable_length (scp_durable_t *pool, uint32_t id)
+{
+  uint32_t len;
+
+  if (id >= pool->size)
+    return 0UL;
+  memcpy (&len, _scp_durable_record (pool, id), sizeof (len));
+  return len;
+}
+
+uint32_t
+scp_durable_size (scp_durable_t *pool)
+{
+  return pool->size;
+}
+
+/**
+ * @brief Makes every insertion so far durable.
+ *
+ * The new records are flushed first, then the index, and only then is the
+ * header rewritten (and flushed) to cover them; a crash at any point thus
+ * leaves either the previous or the new commit visible.
+ *
+ * @return `true` on success, `false` (with `errno` set) if a flush failed,
+ * in which case nothing new is published.
+ */
+bool
+scp_durable_commit (scp_durable_t *pool)
+{
+  if (pool->committed == pool->size)
+    return true;
+
+  if (!_scp_durable_flush (pool->data,
+                           SCP_DURABLE_HEADER_SIZE
+                               + pool->committed_arena_size,
+                           SCP_DURABLE_HEADER_SIZE + pool->arena_size)
+      || !_scp_durable_flush (pool->index, 0UL, pool->index_length))
+    return false;
+
+  _scp_durable_publish (pool);
+  if (!_scp_durable_flush (pool->data, 0UL, SCP_DURABLE_HEADER_SIZE))
+    return false;
+
+  pool->committed = pool->size;
+  pool->committed_arena_size = pool->arena_size;
+  return true;
+}
+
+/* Maps the data file, initializing it first if it is empty */
+static bool
+_scp_durable_map_data (scp_durable_t *pool)
+{
+  struct _scp_durable_header header = { 0 };
+  struct stat st;
+
+  if (fstat (pool->fd, &st) < 0)
+    return false;
+
+  if (!st.st_size)
+    {
+      memcpy (header.magic, SCP_DURABLE_MAGIC, sizeof (header.magic));
+      header.seed = SCP_DURABLE_SEED;
+      st.st_size = SCP_DURABLE_HEADER_SIZE + SCP_DURABLE_INITIAL_ARENA;
+      if (ftruncate (pool->fd, st.st_size) < 0
+          || pwrite (pool->fd, &header, sizeof (header), 0)
+                 != sizeof (header)
+          || fsync (pool->fd) < 0)
+        return false;
+    }
+
+  if ((size_t)st.st_size < SCP_DURABLE_HEADER_SIZE)
+    {
+      errno = EINVAL;
+      return false;
+    }
+
+  pool->data = mmap (NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                     pool->fd, 0);
+  if (pool->data == MAP_FAILED)
+    {
+      pool->data = NULL;
+      return false;
+    }
+  pool->data_length = st.st_size;
+
+  if (memcmp (_scp_durable_header (pool)->magic, SCP_DURABLE_MAGIC, 8)
+      || _scp_durable_header (pool)->seed != SCP_DURABLE_SEED)
+    {
+      errno = EINVAL;
+      return false;
+    }
+  return true;
+}
+
+/* Grows the data file (doubling it) until the arena spans `min_size` bytes */
+static bool
+_scp_durable_grow_data (scp_durable_t *pool, uint64_t min_size)
+{
+  size_t length = pool->data_length;
+  void *data;
+
+  if (SCP_DURABLE_HEADER_SIZE + min_size <= length)
+    return true;
+  while (length < SCP_DURABLE_HEADER_SIZE + min_size)
+    length <<= 1;
+
+  if (ftruncate (pool->fd, length) < 0)
+    return false;
+
+#ifdef MREMAP_MAYMOVE
+  data = mremap (pool->data, pool->data_length, length, MREMAP_MAYMOVE);
+#else
+  data = mmap (NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, pool->fd, 0);
+  if (data != MAP_FAILED)
+    munmap (pool->data, pool->data_length);
+#endif
+  if (data == MAP_FAILED)
+    return false;
+
+  pool->data = data, pool->data_length = length;
+  return true;
+}
+
+/**
+ * @brief Maps the index file, or rebuilds it if it is missing or damaged.
+ *
+ * Should the index hold strings beyond the last commit, its slots are
+ * relinked from the committed identifiers alone, in increasing order (the
+ * hashes stored within the slots spare hashing the strings again). Merely
+ * clearing the uncommitted slots could break the probe sequences of
+ * committed strings placed after them.
+ */
+static bool
+_scp_durable_open_index (scp_durable_t *pool)
+{
+  struct _scp_durable_index_header *header;
+  char *path = _scp_durable_index_path (pool->path, ".idx");
+  uint32_t capacity = SCP_DURABLE_INITIAL_IDS, i;
+  struct stat st;
+  uint64_t *slots;
+  bool stale = false;
+
+  pool->index_fd = open (path, O_RDWR);
+  free (path);
+  if (pool->index_fd >= 0 && fstat (pool->index_fd, &st) == 0
+      && (size_t)st.st_size >= sizeof (*header))
+    {
+      pool->index = mmap (NULL, st.st_size, PROT_READ | PROT_WRITE,
+                          MAP_SHARED, pool->index_fd, 0);
+      if (pool->index == MAP_FAILED)
+        {
+          pool->index = NULL;
+          return false;
+        }
+      pool->index_length = st.st_size;
+
+      header = pool->index;
+      if (!memcmp (header->magic, SCP_DURABLE_INDEX_MAGIC, 8)
+          && header->seed == SCP_DURABLE_SEED
+          && header->id_capacity >= pool->committed
+          && !(header->slot_count & (header->slot_count - 1U))
+          && sizeof (*header)
+                     + (header->id_capacity + (uint64_t)header->slot_count)
+                           * sizeof (uint64_t)
+                 <= pool->index_length)
+        {
+          pool->id_capacity = header->id_capacity;
+          pool->slot_mask = header->slot_count - 1U;
+          pool->offsets = (uint64_t *)(header + 1);
+          pool->slots = pool->offsets + pool->id_capacity;
+
+          for (i = 0U; i <= pool->slot_mask && !stale; ++i)
+            stale = (uint32_t)pool->slots[i] > pool->committed;
+          if (!stale)
+            return true;
+
+          slots = malloc ((pool->slot_mask + 1ULL) * sizeof (*slots));
+          if (!slots)
+            _die ("%s: Unable to allocate slots (errno=%d)", __func__, errno);
+          memcpy (slots, pool->slots,
+                  (pool->slot_mask + 1ULL) * sizeof (*slots));
+          memset (pool->slots, 0,
+                  (pool->slot_mask + 1ULL) * sizeof (*slots));
+          _scp_durable_relink (pool->slots, pool->slot_mask, slots,
+                               pool->slot_mask, pool->committed);
+          free (slots);
+          return _scp_durable_flush (pool->index, 0UL, pool->index_length);
+        }
+    }
+
+  /* Rebuild the offsets from the arena, then the slots from the offsets */
+  while (capacity < pool->committed)
+    capacity <<= 1;
+  if (!_scp_durable_reindex (pool, capacity))
+    return false;
+
+  for (i = 0U; i < pool->committed; ++i)
+    pool->offsets[i] = i ? pool->offsets[i - 1]
+                               + SCP_DURABLE_RECORD_SIZE (
+                                   scp_durable_length (pool, i - 1U))
+                         : 0U;
+  for (i = 0U; i < pool->committed; ++i)
+    _scp_durable_link (pool->slots, pool->slot_mask,
+                       scp_hash64 (scp_durable_string (pool, i),
+                                   scp_durable_length (pool, i),
+                                   SCP_DURABLE_SEED),
+                       i);
+  return _scp_durable_flush (pool->index, 0UL, pool->index_length);
+}
+
+/**
+ * @brief Replaces the index file by a larger one.
+ *
+ * The new index is written and flushed under a temporary name, then renamed
+ * over the previous one, so that a valid index always exists on disk.
+ */
+static bool
+_scp_durable_reindex (scp_durable_t *pool, uint32_t id_capacity)
+{
+  struct _scp_durable_index_header header = { 0 };
+  char *path = _scp_durable_index_path (pool->path, ".idx");
+  char *tmp = _scp_durable_index_path (pool->path, ".idx.tmp");
+  char *dir = _scp_durable_index_path (pool->path, "");
+  size_t length;
+  uint64_t *offsets, *slots;
+  void *index;
+  int fd, dir_fd, error = 0;
+
+  memcpy (header.magic, SCP_DURABLE_INDEX_MAGIC, sizeof (header.magic));
+  header.id_capacity = id_capacity, header.slot_count = id_capacity << 1;
+  header.seed = SCP_DURABLE_SEED;
+  length = sizeof (header)
+           + ((size_t)id_capacity + header.slot_count) * sizeof (uint64_t);
+
+  fd = open (tmp, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0 || ftruncate (fd, length) < 0)
+    goto fail;
+  index = mmap (NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (index == MAP_FAILED)
+    goto fail;
+
+  memcpy (index, &header, sizeof (header));
+  offsets = (uint64_t *)((char *)index + sizeof (header));
+  slots = offsets + id_capacity;
+  if (pool->offsets)
+    memcpy (offsets, pool->offsets, pool->size * sizeof (*offsets));
+  if (pool->slots)
+    _scp_durable_relink (slots, header.slot_count - 1U, pool->slots,
+                         pool->slot_mask, pool->size);
+
+  if (msync (index, length, MS_SYNC) < 0 || rename (tmp, path) < 0)
+    {
+      error = errno;
+      munmap (index, length);
+      errno = error;
+      goto fail;
+    }
+
+  /* The rename itself must be durable before any commit relies on it */
+  dir_fd = open (dirname (dir), O_RDONLY);
+  if (dir_fd >= 0)
+    fsync (dir_fd), close (dir_fd);
+
+  if (pool->index)
+    munmap (pool->index, pool->index_length);
+  if (pool->index_fd >= 0)
+    close (pool->index_fd);
+
+  pool->index = index, pool->index_length = length, pool->index_fd = fd;
+  pool->offsets = offsets, pool->slots = slots;
+  pool->id_capacity = id_capacity, pool->slot_mask = header.slot_count - 1U;
+  free (path), free (tmp), free (dir);
+  return true;
+
+fail:
+  error = errno;
+  if (fd >= 0)
+    close (fd), unlink (tmp);
+  free (path), free (tmp), free (dir);
+  errno = error;
+  return false;
+}
+
+/* Stores an identifier in the first free slot of its probe sequence */
+static void
+_scp_durable_link (uint64_t *slots, uint32_t slot_mask, uint64_t hash,
+                   uint32_t id)
+{
+  uint32_t at = (hash >> 32) & slot_mask;
+
+  while (slots[at])
+    at = (at + 1U) & slot_mask;
+  slots[at] = (hash & 0xFFFFFFFF00000000ULL) | (id + 1ULL);
+}
+
+/**
+ * @brief Links the identifiers [0, count) of a table into another one, in
+ * increasing order.
+ *
+ * Following identifier order (rather than slot order) keeps every probe
+ * sequence ordered by identifier, so that the slots of uncommitted strings
+ * always follow those of committed ones.
+ */
+static void
+_scp_durable_relink (uint64_t *slots, uint32_t slot_mask,
+                     const uint64_t *old_slots, uint32_t old_slot_mask,
+                     uint32_t count)
+{
+  uint64_t *hashes = malloc ((count + 1ULL) * sizeof (*hashes));
+  uint32_t i, id;
+
+  if (!hashes)
+    _die ("%s: Unable to allocate hashes (errno=%d)", __func__, errno);
+
+  for (i = 0U; i <= old_slot_mask; ++i)
+    if (old_slots[i] && (id = (uint32_t)old_slots[i] - 1U) < count)
+      hashes[id] = old_slots[i] & 0xFFFFFFFF00000000ULL;
+  for (id = 0U; id < count; ++id)
+    _scp_durable_link (slots, slot_mask, hashes[id], id);
+  free (hashes);
+}
+
+/* Flushes the pages of a shared mapping spanning [from, to) */
+static bool
+_scp_durable_flush (void *base, size_t from, size_t to)
+{
+  size_t page = sysconf (_SC_PAGESIZE);
+
+  from &= ~(page - 1UL);
+  if (from >= to)
+    return true;
+  return msync ((char *)base + from, to - from, MS_SYNC) == 0;
+}
+
+/* Advances the committed size, the arena size first (see the header) */
+static void
+_scp_durable_publish (scp_durable_t *pool)
+{
+  struct _scp_durable_header *header = _scp_durable_header (pool);
+
+  header->arena_size = pool->arena_size;
+  atomic_thread_fence (memory_order_release);
+  header->size = pool->size;
+}
+
+static void
+_scp_durable_release (scp_durable_t *pool)
+{
+  if (pool->data)
+    munmap (pool->data, pool->data_length);
+  if (pool->index)
+    munmap (pool->index, pool->index_length);
+  if (pool->fd >= 0)
+    close (pool->fd);
+  if (pool->index_fd >= 0)
+    close (pool->index_fd);
+  free (pool->path);
+  free (pool);
+}
+
+static char *
+_scp_durable_index_path (const char *path, const char *suffix)
+{
+  char *result = malloc (strlen (path) + strlen (suffix) + 1UL);
+
+  if (!result)
+    _die ("%s: Unable to allocate path (errno=%d)", __func__, errno);
+  return strcat (strcpy (result, path), suffix);
+}
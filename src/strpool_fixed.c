@@ -0,0 +1,206 @@
+/*
+ * strpool_fixed.c - [description]
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "strpool_fixed.h"
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SCP_FIXED_INITIAL_CAPACITY 16U
+#define SCP_FIXED_SEED 0x243F6A8885A308D3ULL
+#define SCP_FIXED_MULTIPLIER 0x9E3779B97F4A7C15ULL
+
+/**
+ * @brief Terminates the program execution due to a critical exception.
+ *
+ * @param fmt Format string for the error message, followed by optional
+ * arguments.
+ * @param ... Optional arguments corresponding to the format string.
+ */
+static void
+_die (const char *fmt, ...)
+{
+  va_list arg;
+
+  va_start (arg, fmt);
+  vfprintf (stderr, fmt, arg);
+  fprintf (stderr, "\n");
+  va_end (arg);
+
+  exit (EXIT_FAILURE);
+}
+
+/*
+ * Defines the functions declared by `SCP_FIXED_DECLARE(name, width)`. The
+ * loops over the words of a key have a constant trip count, so they are
+ * fully unrolled: hashing costs a multiply per word (and a final avalanche),
+ * and comparing two keys a (vectorizable) XOR and OR per word, with a single
+ * branch on the result.
+ * The index is kept at most half full, so probe sequences stay short.
+ */
+#define SCP_FIXED_DEFINE(name, width)                                         \
+  static inline uint64_t _scp_##name##_hash (uint64_t seed,                   \
+                                             const uint64_t *key)             \
+  {                                                                           \
+    uint64_t h = seed;                                                        \
+    uint32_t i;                                                               \
+                                                                              \
+    for (i = 0U; i < (width) / 8U; ++i)                                       \
+      h = (h ^ key[i]) * SCP_FIXED_MULTIPLIER;                                \
+                                                                              \
+    /* Slots are homed on the low bits, which the multiplies alone leave     \
+       blind to the high bytes of the last word (murmur3's fmix64) */        \
+    h ^= h >> 33, h *= 0xFF51AFD7ED558CCDULL;                                 \
+    h ^= h >> 33, h *= 0xC4CEB9FE1A85EC53ULL;                                 \
+    return h ^ (h >> 33);                                                     \
+  }                                                                           \
+                                                                              \
+  static inline bool _scp_##name##_equals (const uint64_t *a,                 \
+                                           const uint64_t *b)                 \
+  {                                                                           \
+    uint64_t diff = 0U;                                                       \
+    uint32_t i;                                                               \
+                                                                              \
+    for (i = 0U; i < (width) / 8U; ++i)                                       \
+      diff |= a[i] ^ b[i];                                                    \
+    return !diff;                                                             \
+  }                                                                           \
+                                                                              \
+  /* Finds the slot of a key, or the unused slot where it belongs */         \
+  static inline scp_##name##_slot_t *_scp_##name##_find (                     \
+      const scp_##name##_t *pool, const uint64_t *key)                        \
+  {                                                                           \
+    uint32_t mask = pool->capacity - 1U;                                      \
+    uint32_t at = _scp_##name##_hash (pool->seed, key) & mask;                \
+                                                                              \
+    while (pool->table[at].id != SCP_INVALID_ID                               \
+           && !_scp_##name##_equals (pool->table[at].key, key))               \
+      at = (at + 1U) & mask;                                                  \
+    return pool->table + at;                                                  \
+  }                                                                           \
+                                                                              \
+  static void _scp_##name##_resize (scp_##name##_t *pool, uint32_t capacity) \
+  {                                                                           \
+    scp_##name##_slot_t *old_table = pool->table, *slot;                      \
+    uint32_t i, old_capacity = pool->capacity;                                \
+                                                                              \
+    pool->table = malloc (capacity * sizeof (*pool->table));                  \
+    if (!pool->table)                                                         \
+      _die ("%s: Unable to allocate pool->table (errno=%d)", __func__,        \
+            errno);                                                           \
+    memset (pool->table, 0xFF, capacity * sizeof (*pool->table));            \
+    pool->capacity = capacity;                                                \
+                                                                              \
+    for (i = 0U; i < old_capacity; ++i)                                       \
+      if (old_table[i].id != SCP_INVALID_ID)                                  \
+        {                                                                     \
+          slot = _scp_##name##_find (pool, old_table[i].key);                 \
+          *slot = old_table[i];                                               \
+        }                                                                     \
+    free (old_table);                                                         \
+  }                                                                           \
+                                                                              \
+  scp_##name##_t *scp_##name##_new ()                                         \
+  {                                                                           \
+    scp_##name##_t *pool = malloc (sizeof *pool);                             \
+    if (!pool)                                                                \
+      _die ("%s: Unable to allocate fixed-width pool (errno=%d).", __func__,  \
+            errno);                                                           \
+    pool->_dynamic = true;                                                    \
+                                                                              \
+    return pool;                                                              \
+  }                                                                           \
+                                                                              \
+  scp_##name##_t *scp_##name##_init (scp_##name##_t *pool)                    \
+  {                                                                           \
+    if (!pool) /* Ensure that the pool is properly allocated */               \
+      pool = scp_##name##_new ();                                             \
+                                                                              \
+    pool->table = NULL, pool->capacity = 0U, pool->size = 0U;                 \
+    pool->seed = SCP_FIXED_SEED;                                              \
+    _scp_##name##_resize (pool, SCP_FIXED_INITIAL_CAPACITY);                  \
+                                                                              \
+    pool->keys_capacity = SCP_FIXED_INITIAL_CAPACITY;                         \
+    pool->keys = malloc (pool->keys_capacity * (size_t)(width));              \
+    if (!pool->keys)                                                          \
+      _die ("%s: Unable to allocate pool->keys (errno=%d)", __func__, errno); \
+    return pool;                                                              \
+  }                                                                           \
+                                                                              \
+  void scp_##name##_free (scp_##name##_t *pool)                               \
+  {                                                                           \
+    free (pool->table);                                                       \
+    free (pool->keys);                                                        \
+                                                                              \
+    if (pool->_dynamic)                                                       \
+      free (pool);                                                            \
+  }                                                                           \
+                                                                              \
+  /* Interns a key of `width` bytes (which needn't be aligned) */             \
+  uint32_t scp_##name##_insert (scp_##name##_t *pool, const void *key)        \
+  {                                                                           \
+    uint64_t words[(width) / 8U];                                             \
+    scp_##name##_slot_t *slot;                                                \
+                                                                              \
+    memcpy (words, key, (width));                                             \
+    if ((pool->size + 1ULL) * 2U > pool->capacity)                            \
+      {                                                                       \
+        if (pool->capacity > UINT32_MAX >> 1)                                 \
+          _die ("%s: Fixed-width pool identifiers have overflowed.",          \
+                __func__);                                                    \
+        _scp_##name##_resize (pool, pool->capacity << 1);                     \
+      }                                                                       \
+                                                                              \
+    slot = _scp_##name##_find (pool, words);                                  \
+    if (slot->id != SCP_INVALID_ID)                                           \
+      return slot->id;                                                        \
+                                                                              \
+    if (pool->size == pool->keys_capacity)                                    \
+      {                                                                       \
+        pool->keys_capacity <<= 1;                                            \
+        pool->keys = realloc (pool->keys,                                     \
+                              pool->keys_capacity * (size_t)(width));         \
+        if (!pool->keys)                                                      \
+          _die ("%s: Unable to allocate pool->keys (errno=%d)", __func__,     \
+                errno);                                                       \
+      }                                                                       \
+                                                                              \
+    memcpy (slot->key, words, (width));                                       \
+    memcpy (pool->keys + pool->size * ((width) / 8U), words, (width));        \
+    return slot->id = pool->size++;                                           \
+  }                                                                           \
+                                                                              \
+  /* Retrieves the identifier of a key, or `SCP_INVALID_ID` if missing */     \
+  uint32_t scp_##name##_lookup (const scp_##name##_t *pool, const void *key)  \
+  {                                                                           \
+    uint64_t words[(width) / 8U];                                             \
+                                                                              \
+    memcpy (words, key, (width));                                             \
+    return _scp_##name##_find (pool, words)->id;                              \
+  }                                                                           \
+                                                                              \
+  /* Resolves an identifier into its key, or `NULL` if it is unknown */       \
+  const void *scp_##name##_key (const scp_##name##_t *pool, uint32_t id)      \
+  {                                                                           \
+    return id < pool->size ? pool->keys + (size_t)id * ((width) / 8U) : NULL; \
+  }                                                                           \
+                                                                              \
+  uint32_t scp_##name##_size (const scp_##name##_t *pool)                     \
+  {                                                                           \
+    return pool->size;                                                        \
+  }                                                                           \
+                                                                              \
+  size_t scp_##name##_memory_usage (const scp_##name##_t *pool)               \
+  {                                                                           \
+    return sizeof (*pool) + pool->capacity * sizeof (*pool->table)            \
+           + pool->keys_capacity * (size_t)(width);                           \
+  }
+
+SCP_FIXED_DEFINE (fixed16, 16U)
+SCP_FIXED_DEFINE (fixed32, 32U)
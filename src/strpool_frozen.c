@@ -0,0 +1,681 @@
+/*
+ * strpool_frozen.c - [description]
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#define _POSIX_C_SOURCE 200809L /* strnlen(...) */
+
+#include "strpool_frozen.h"
+#include "strpool_sort.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SCP_FROZEN_MAGIC "SCPFRZ\0\1"
+#define SCP_FROZEN_DEFAULT_SEED 0x5CF0F2E5A11CE5EDULL
+
+#define SCP_FROZEN_SORTED 0x1U /* Identifiers follow the order of strings */
+
+/* Source: https://doi.org/10.1145/3404835.3462849 (PTHash) */
+#define SCP_FROZEN_BUCKET_LOAD 4U  /* Average number of keys per bucket */
+#define SCP_FROZEN_MAX_PILOT 65536U /* Pilots tried before reseeding */
+#define SCP_FROZEN_MAX_SEEDS 16U
+
+/*
+ * On-disk (and in-memory) header of a frozen image. Every section is
+ * addressed relative to the start of the image, and aligned to 8 bytes.
+ * Integers are stored in native byte order.
+ */
+struct _scp_frozen_header
+{
+  char magic[8];
+  uint32_t size;
+  uint32_t bucket_count;
+  uint32_t slot_count;
+  uint32_t flags;
+  uint64_t seed;
+
+  uint64_t pilots_at;
+  uint64_t slots_at;
+  uint64_t offsets_at;
+  uint64_t arena_at;
+  uint64_t image_size;
+};
+
+/* Pairs a string with its hit count, while it is being ranked */
+struct _scp_frozen_rank
+{
+  uint64_t count;
+  uint32_t id;
+};
+
+/* Enumerates the strings of a frozen pool in a permuted order */
+struct _scp_frozen_permutation
+{
+  const scp_frozen_t *frozen;
+  const struct _scp_frozen_rank *ranks;
+};
+
+/* Enumerates the strings of a pool by increasing rank */
+struct _scp_frozen_order
+{
+  strpool_t *pool;
+  const uint32_t *ids; /* Identifier of each rank */
+};
+
+static const char *_scp_freeze_source (void *ctx, uint32_t id, size_t *n);
+static const char *_scp_order_source (void *ctx, uint32_t id, size_t *n);
+static const char *_scp_permutation_source (void *ctx, uint32_t id,
+                                            size_t *n);
+static int _scp_rank_compare (const void *a, const void *b);
+static bool _scp_frozen_place (scp_frozen_t *frozen, const uint64_t *hashes);
+static bool _scp_frozen_attach (scp_frozen_t *frozen, void *image,
+                                size_t image_size);
+static bool _scp_frozen_validate (const scp_frozen_t *frozen);
+
+static inline uint32_t _scp_frozen_bucket (uint64_t hash,
+                                           uint32_t bucket_count);
+static inline uint32_t _scp_frozen_slot (uint64_t hash, uint32_t pilot,
+                                         uint32_t slot_count);
+
+/**
+ * @brief Terminates the program execution due to a critical exception.
+ *
+ * @param fmt Format string for the error message, followed by optional
+ * arguments.
+ * @param ... Optional arguments corresponding to the format string.
+ */
+static void
+_die (const char *fmt, ...)
+{
+  va_list arg;
+
+  va_start (arg, fmt);
+  vfprintf (stderr, fmt, arg);
+  fprintf (stderr, "\n");
+  va_end (arg);
+
+  exit (EXIT_FAILURE);
+}
+
+/**
+ * @brief Freezes the current contents of a string pool.
+ *
+ * The pool is left untouched, and may keep growing; later insertions are
+ * simply not reflected within the frozen pool.
+ *
+ * @param pool The string pool to freeze.
+ *
+ * @return A newly allocated frozen pool, to be released with
+ * `scp_frozen_free(...)`.
+ */
+scp_frozen_t *
+scp_freeze (strpool_t *pool)
+{
+  return scp_frozen_build (_scp_freeze_source, pool, scp_size (pool));
+}
+
+/**
+ * @brief Freezes the current contents of a string pool, renumbering its
+ * strings in lexicographic order.
+ *
+ * Identifier `i` of the frozen pool is the `i`-th smallest string of the pool
+ * by `strcmp(...)` order, as ranked by `scp_build_ranks(...)`. The arena is
+ * laid out in the same order, so that ranges of identifiers are also
+ * contiguous ranges of the arena.
+ *
+ * @param pool The string pool to freeze.
+ * @param remap Receives the frozen identifier of each identifier of `pool`
+ * (may be `NULL`).
+ *
+ * @return A newly allocated frozen pool, to be released with
+ * `scp_frozen_free(...)`.
+ */
+scp_frozen_t *
+scp_freeze_sorted (strpool_t *pool, uint32_t *remap)
+{
+  struct _scp_frozen_order order = { pool, NULL };
+  struct _scp_frozen_header *header;
+  scp_frozen_t *frozen;
+  uint32_t *ids, id, n = scp_size (pool);
+
+  if (pool->ranks_size != n)
+    scp_build_ranks (pool);
+
+  ids = malloc ((n + 1ULL) * sizeof (*ids));
+  if (!ids)
+    _die ("%s: Unable to allocate order (errno=%d)", __func__, errno);
+  for (id = 0U; id < n; ++id)
+    ids[pool->ranks[id]] = id;
+
+  order.ids = ids;
+  frozen = scp_frozen_build (_scp_order_source, &order, n);
+  if (remap)
+    memcpy (remap, pool->ranks, n * sizeof (*remap));
+  free (ids);
+
+  /* The flag is persisted, so that mapped images remain searchable */
+  header = frozen->image;
+  header->flags |= SCP_FROZEN_SORTED;
+  frozen->sorted = true;
+  return frozen;
+}
+
+/**
+ * @brief Builds a frozen pool from an arbitrary sequence of strings.
+ *
+ * The strings are enumerated in identifier order, and must be distinct.
+ *
+ * @param source Callback returning the string of each identifier.
+ * @param ctx Opaque pointer forwarded to `source`.
+ * @param count The number of strings (and identifiers).
+ *
+ * @return A newly allocated frozen pool.
+ */
+scp_frozen_t *
+scp_frozen_build (scp_frozen_source_t source, void *ctx, uint32_t count)
+{
+  struct _scp_frozen_header header = { 0 };
+  scp_frozen_t *frozen;
+  uint64_t *hashes, *offsets, arena_size = 0U;
+  const char *s;
+  char *image;
+  size_t n;
+  uint32_t i, attempt;
+
+  for (i = 0U; i < count; ++i)
+    {
+      source (ctx, i, &n);
+      arena_size += n + 1U; /* Null terminator */
+    }
+
+  memcpy (header.magic, SCP_FROZEN_MAGIC, sizeof (header.magic));
+  header.size = count;
+  header.bucket_count = count / SCP_FROZEN_BUCKET_LOAD + 1U;
+  header.slot_count = count + count / 32U + 1U;
+
+  /* Lay the sections out behind the header, each aligned to 8 bytes */
+  header.pilots_at = (sizeof (header) + 7U) & ~7ULL;
+  header.slots_at
+      = (header.pilots_at + 4ULL * header.bucket_count + 7U) & ~7ULL;
+  header.offsets_at
+      = (header.slots_at + 4ULL * header.slot_count + 7U) & ~7ULL;
+  header.arena_at = header.offsets_at + 8ULL * (count + 1ULL);
+  header.image_size = header.arena_at + arena_size;
+
+  image = calloc (1, header.image_size);
+  hashes = malloc ((count + 1ULL) * sizeof (*hashes));
+  frozen = malloc (sizeof (*frozen));
+  if (!image || !hashes || !frozen)
+    _die ("%s: Unable to allocate frozen pool (errno=%d)", __func__, errno);
+
+  /* Copy the strings, which only have to be hashed once per seed attempt */
+  offsets = (uint64_t *)(image + header.offsets_at), offsets[0] = 0U;
+  for (i = 0U; i < count; ++i)
+    {
+      s = source (ctx, i, &n);
+      memcpy (image + header.arena_at + offsets[i], s, n);
+      offsets[i + 1] = offsets[i] + n + 1U;
+    }
+
+  for (attempt = 0U; attempt < SCP_FROZEN_MAX_SEEDS; ++attempt)
+    {
+      header.seed = SCP_FROZEN_DEFAULT_SEED + attempt;
+      memcpy (image, &header, sizeof (header));
+      _scp_frozen_attach (frozen, image, header.image_size);
+
+      for (i = 0U; i < count; ++i)
+        hashes[i] = scp_hash64 (frozen->arena + offsets[i],
+                                offsets[i + 1] - offsets[i] - 1U, header.seed);
+      if (_scp_frozen_place (frozen, hashes))
+        break;
+    }
+
+  if (attempt == SCP_FROZEN_MAX_SEEDS)
+    _die ("%s: Unable to find a perfect hash function (are the %u strings "
+          "distinct?)",
+          __func__, count);
+
+  free (hashes);
+  frozen->_mapped = false;
+  return frozen;
+}
+
+void
+scp_frozen_free (scp_frozen_t *frozen)
+{
+  if (frozen->_mapped)
+    munmap (frozen->image, frozen->image_size);
+  else
+    free (frozen->image);
+
+  free (frozen);
+}
+
+/**
+ * @brief Renumbers a frozen pool by decreasing frequency, hot strings first.
+ *
+ * Identifiers are reassigned so that the most frequent strings receive the
+ * smallest identifiers (ties keep their relative order), and the arena is
+ * laid out in the same order. Hence, hot strings share cache lines and pages,
+ * and columns of identifiers compress well with variable-length encodings.
+ *
+ * @param frozen The frozen pool to optimize, which is left untouched.
+ * @param counts The hit count of each identifier of `frozen`.
+ * @param remap Receives the new identifier of each previous identifier, so
+ * that existing columns may be translated (may be `NULL`).
+ *
+ * @return A newly allocated frozen pool with the optimized layout.
+ */
+scp_frozen_t *
+scp_optimize_layout (const scp_frozen_t *frozen, const uint64_t *counts,
+                     uint32_t *remap)
+{
+  struct _scp_frozen_permutation permutation = { frozen, NULL };
+  struct _scp_frozen_rank *ranks;
+  scp_frozen_t *optimized;
+  uint32_t id;
+
+  ranks = malloc ((frozen->size + 1ULL) * sizeof (*ranks));
+  if (!ranks)
+    _die ("%s: Unable to allocate ranks (errno=%d)", __func__, errno);
+
+  for (id = 0U; id < frozen->size; ++id)
+    ranks[id].count = counts[id], ranks[id].id = id;
+  qsort (ranks, frozen->size, sizeof (*ranks), _scp_rank_compare);
+
+  permutation.ranks = ranks;
+  optimized = scp_frozen_build (_scp_permutation_source, &permutation,
+                                frozen->size);
+
+  if (remap)
+    for (id = 0U; id < frozen->size; ++id)
+      remap[ranks[id].id] = id;
+
+  free (ranks);
+  return optimized;
+}
+
+/**
+ * @brief Writes the image of a frozen pool to a file.
+ *
+ * @return `true` on success, `false` otherwise (with `errno` set).
+ */
+bool
+scp_frozen_save (const scp_frozen_t *frozen, const char *path)
+{
+  FILE *file = fopen (path, "wb");
+  bool written;
+
+  if (!file)
+    return false;
+
+  written = fwrite (frozen->image, 1, frozen->image_size, file)
+            == frozen->image_size;
+  return (fclose (file) == 0) && written;
+}
+
+/**
+ * @brief Maps a frozen pool previously written by `scp_frozen_save(...)`.
+ *
+ * The image is mapped read-only and shared, so that its pages are loaded
+ * lazily and shared between every process mapping the same file.
+ *
+ * @return The mapped frozen pool, or `NULL` (with `errno` set) if the file
+ * couldn't be mapped or isn't a frozen image.
+ */
+scp_frozen_t *
+scp_frozen_open (const char *path)
+{
+  scp_frozen_t *frozen;
+  struct stat st;
+  void *image;
+  int fd = open (path, O_RDONLY);
+
+  if (fd < 0)
+    return NULL;
+  if (fstat (fd, &st) < 0)
+    {
+      close (fd);
+      return NULL;
+    }
+
+  if ((size_t)st.st_size < sizeof (struct _scp_frozen_header))
+    {
+      close (fd);
+      errno = EINVAL;
+      return NULL;
+    }
+
+  image = mmap (NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close (fd); /* The mapping holds its own reference to the file */
+  if (image == MAP_FAILED)
+    return NULL;
+
+  frozen = malloc (sizeof (*frozen));
+  if (!frozen)
+    _die ("%s: Unable to allocate frozen pool (errno=%d)", __func__, errno);
+
+  frozen->_mapped = true;
+  if (!_scp_frozen_attach (frozen, image, st.st_size)
+      || !_scp_frozen_validate (frozen))
+    {
+      munmap (image, st.st_size);
+      free (frozen);
+      errno = EINVAL;
+      return NULL;
+    }
+  return frozen;
+}
+
+/**
+ * @brief Retrieves the identifier of a string within a frozen pool.
+ *
+ * @param frozen The frozen pool to search.
+ * @param s The string to search for.
+ * @param n The maximum length of `s`, or `-1UL` if it is null-terminated.
+ *
+ * @return The identifier of the string, or `SCP_INVALID_ID` if the frozen
+ * pool doesn't contain it.
+ */
+uint32_t
+scp_frozen_lookup (const scp_frozen_t *frozen, const char *s, size_t n)
+{
+  uint64_t hash;
+  uint32_t id;
+  size_t len = n == -1UL ? strlen (s) : strnlen (s, n);
+
+  if (!frozen->size)
+    return SCP_INVALID_ID;
+
+  hash = scp_hash64 (s, len, frozen->seed);
+  id = frozen->slots[_scp_frozen_slot (
+      hash, frozen->pilots[_scp_frozen_bucket (hash, frozen->bucket_count)],
+      frozen->slot_count)];
+
+  /* The perfect hash function only discriminates strings of the pool */
+  if (id == SCP_INVALID_ID || scp_frozen_length (frozen, id) != len
+      || memcmp (frozen->arena + frozen->offsets[id], s, len) != 0)
+    return SCP_INVALID_ID;
+  return id;
+}
+
+const char *
+scp_frozen_string (const scp_frozen_t *frozen, uint32_t id)
+{
+  return id < frozen->size ? frozen->arena + frozen->offsets[id] : NULL;
+}
+
+size_t
+scp_frozen_length (const scp_frozen_t *frozen, uint32_t id)
+{
+  return frozen->offsets[id + 1] - frozen->offsets[id] - 1U;
+}
+
+/**
+ * @brief Searches the first string of a sorted frozen pool that isn't less
+ * than a given string.
+ *
+ * A range predicate such as `s >= "abc" AND s < "abd"` thus becomes the
+ * range of identifiers [`lower_bound("abc")`, `lower_bound("abd")`).
+ *
+ * @param frozen A frozen pool built by `scp_freeze_sorted(...)`.
+ * @param s The string to search for.
+ * @param n The maximum length of `s`, or `-1UL` if it is null-terminated.
+ *
+ * @return The identifier of the first string not less than `s`, which is
+ * the size of the frozen pool if every string is less than `s`, or
+ * `SCP_INVALID_ID` if the identifiers of the frozen pool aren't sorted.
+ */
+uint32_t
+scp_frozen_lower_bound (const scp_frozen_t *frozen, const char *s, size_t n)
+{
+  size_t len = n == -1UL ? strlen (s) : strnlen (s, n), m;
+  uint32_t low = 0U, high = frozen->size, mid;
+  int order;
+
+  if (!frozen->sorted)
+    return SCP_INVALID_ID;
+
+  while (low < high)
+    {
+      mid = low + (high - low) / 2U;
+      m = scp_frozen_length (frozen, mid);
+      order = memcmp (frozen->arena + frozen->offsets[mid], s,
+                      m < len ? m : len);
+      if (order < 0 || (order == 0 && m < len))
+        low = mid + 1U;
+      else
+        high = mid;
+    }
+  return low;
+}
+
+uint32_t
+scp_frozen_size (const scp_frozen_t *frozen)
+{
+  return frozen->size;
+}
+
+static const char *
+_scp_freeze_source (void *ctx, uint32_t id, size_t *n)
+{
+  return scp_view (ctx, id, n);
+}
+
+static const char *
+_scp_order_source (void *ctx, uint32_t id, size_t *n)
+{
+  struct _scp_frozen_order *order = ctx;
+  return scp_view (order->pool, order->ids[id], n);
+}
+
+static const char *
+_scp_permutation_source (void *ctx, uint32_t id, size_t *n)
+{
+  struct _scp_frozen_permutation *permutation = ctx;
+  uint32_t previous = permutation->ranks[id].id;
+
+  *n = scp_frozen_length (permutation->frozen, previous);
+  return scp_frozen_string (permutation->frozen, previous);
+}
+
+/* Orders by decreasing count, then by increasing identifier */
+static int
+_scp_rank_compare (const void *a, const void *b)
+{
+  const struct _scp_frozen_rank *x = a, *y = b;
+
+  if (x->count != y->count)
+    return x->count < y->count ? 1 : -1;
+  return (x->id > y->id) - (x->id < y->id);
+}
+
+/**
+ * @brief Searches a pilot for every bucket of the perfect hash function.
+ *
+ * Buckets are processed from the largest to the smallest, and each one tries
+ * increasing pilots until its keys land on distinct free slots.
+ *
+ * @param frozen The frozen pool whose pilots and slots should be populated.
+ * @param hashes The hash of every string, under the seed of the image.
+ *
+ * @return `true` if every bucket found a pilot, `false` if the image must be
+ * reseeded.
+ */
+static bool
+_scp_frozen_place (scp_frozen_t *frozen, const uint64_t *hashes)
+{
+  uint32_t *pilots = (uint32_t *)frozen->pilots;
+  uint32_t *slots = (uint32_t *)frozen->slots;
+  uint32_t *start, *keys, *order, *by_size, *positions;
+  uint32_t i, j, k, b, pilot, size, max_size = 0U;
+  uint64_t *taken;
+  bool placed = true;
+
+  start = calloc (frozen->bucket_count + 2ULL, sizeof (*start));
+  keys = malloc ((frozen->size + 1ULL) * sizeof (*keys));
+  order = malloc ((frozen->bucket_count + 1ULL) * sizeof (*order));
+  taken = calloc (frozen->slot_count / 64U + 1U, sizeof (*taken));
+  if (!start || !keys || !order || !taken)
+    _die ("%s: Unable to allocate perfect hash (errno=%d)", __func__, errno);
+
+  /* Group the keys by bucket (counting sort) */
+  for (i = 0U; i < frozen->size; ++i)
+    start[_scp_frozen_bucket (hashes[i], frozen->bucket_count) + 2U]++;
+  for (b = 0U; b < frozen->bucket_count; ++b)
+    {
+      start[b + 2U] += start[b + 1U];
+      size = start[b + 2U] - start[b + 1U];
+      max_size = size > max_size ? size : max_size;
+    }
+  for (i = 0U; i < frozen->size; ++i)
+    keys[start[_scp_frozen_bucket (hashes[i], frozen->bucket_count) + 1U]++]
+        = i;
+
+  /* Order the buckets by decreasing size (counting sort) */
+  by_size = calloc (max_size + 2ULL, sizeof (*by_size));
+  positions = malloc ((max_size + 1ULL) * sizeof (*positions));
+  if (!by_size || !positions)
+    _die ("%s: Unable to allocate perfect hash (errno=%d)", __func__, errno);
+  for (b = 0U; b < frozen->bucket_count; ++b)
+    by_size[max_size - (start[b + 1U] - start[b])]++;
+  for (size = 0U, i = 0U; i <= max_size; ++i)
+    j = by_size[i], by_size[i] = size, size += j;
+  for (b = 0U; b < frozen->bucket_count; ++b)
+    order[by_size[max_size - (start[b + 1U] - start[b])]++] = b;
+
+  memset (slots, 0xFF, frozen->slot_count * sizeof (*slots));
+  memset (pilots, 0, frozen->bucket_count * sizeof (*pilots));
+  for (i = 0U; i < frozen->bucket_count && placed; ++i)
+    {
+      b = order[i], size = start[b + 1U] - start[b];
+      if (!size)
+        break; /* Only empty buckets remain */
+
+      for (pilot = 0U; pilot < SCP_FROZEN_MAX_PILOT; ++pilot)
+        {
+          for (j = 0U; j < size; ++j)
+            {
+              positions[j] = _scp_frozen_slot (hashes[keys[start[b] + j]],
+                                               pilot, frozen->slot_count);
+              if (taken[positions[j] >> 6] >> (positions[j] & 63U) & 1U)
+                break;
+              for (k = 0U; k < j && positions[k] != positions[j]; ++k)
+                ;
+              if (k < j)
+                break;
+            }
+          if (j == size)
+            break;
+        }
+
+      if (pilot == SCP_FROZEN_MAX_PILOT)
+        {
+          placed = false;
+          break;
+        }
+
+      pilots[b] = pilot;
+      for (j = 0U; j < size; ++j)
+        {
+          taken[positions[j] >> 6] |= 1ULL << (positions[j] & 63U);
+          slots[positions[j]] = keys[start[b] + j];
+        }
+    }
+
+  free (start), free (keys), free (order);
+  free (taken), free (by_size), free (positions);
+  return placed;
+}
+
+/**
+ * @brief Points the sections of a frozen pool into its image.
+ *
+ * @return `true` if the image is a well-formed frozen image, `false`
+ * otherwise.
+ */
+static bool
+_scp_frozen_attach (scp_frozen_t *frozen, void *image, size_t image_size)
+{
+  const struct _scp_frozen_header *header = image;
+  const char *base = image;
+
+  if (memcmp (header->magic, SCP_FROZEN_MAGIC, sizeof (header->magic)) != 0
+      || header->image_size != image_size
+      || header->pilots_at < sizeof (*header) || header->pilots_at % 4U
+      || header->slots_at % 4U || header->offsets_at % 8U
+      || header->arena_at > image_size
+      || header->pilots_at + 4ULL * header->bucket_count > header->slots_at
+      || header->slots_at + 4ULL * header->slot_count > header->offsets_at
+      || header->offsets_at + 8ULL * (header->size + 1ULL)
+             > header->arena_at)
+    return false;
+
+  frozen->image = image, frozen->image_size = image_size;
+  frozen->size = header->size;
+  frozen->bucket_count = header->bucket_count;
+  frozen->slot_count = header->slot_count;
+  frozen->seed = header->seed;
+  frozen->sorted = (header->flags & SCP_FROZEN_SORTED) != 0U;
+
+  frozen->pilots = (const uint32_t *)(base + header->pilots_at);
+  frozen->slots = (const uint32_t *)(base + header->slots_at);
+  frozen->offsets = (const uint64_t *)(base + header->offsets_at);
+  frozen->arena = base + header->arena_at;
+  return true;
+}
+
+/**
+ * @brief Checks that every offset and slot of an attached image stays within
+ * it, so that an image read from disk can't send lookups out of bounds.
+ *
+ * @return `true` if the image is consistent, `false` otherwise.
+ */
+static bool
+_scp_frozen_validate (const scp_frozen_t *frozen)
+{
+  uint64_t arena_size
+      = frozen->image_size - (uint64_t)(frozen->arena - (char *)frozen->image);
+  uint32_t i;
+
+  if (frozen->size && (!frozen->bucket_count || !frozen->slot_count))
+    return false;
+  if (frozen->offsets[0] != 0U || frozen->offsets[frozen->size] > arena_size)
+    return false;
+
+  /* Each string is followed by its terminator, before the next one starts */
+  for (i = 0U; i < frozen->size; ++i)
+    if (frozen->offsets[i + 1] <= frozen->offsets[i]
+        || frozen->arena[frozen->offsets[i + 1] - 1U] != '\0')
+      return false;
+
+  for (i = 0U; i < frozen->slot_count; ++i)
+    if (frozen->slots[i] >= frozen->size && frozen->slots[i] != SCP_INVALID_ID)
+      return false;
+  return true;
+}
+
+static inline uint32_t
+_scp_frozen_bucket (uint64_t hash, uint32_t bucket_count)
+{
+  return ((hash >> 32) * bucket_count) >> 32;
+}
+
+static inline uint32_t
+_scp_frozen_slot (uint64_t hash, uint32_t pilot, uint32_t slot_count)
+{
+  uint64_t h = hash ^ ((pilot + 1ULL) * 0x9E3779B97F4A7C15ULL);
+
+  h ^= h >> 33, h *= 0xFF51AFD7ED558CCDULL;
+  h ^= h >> 29;
+  return ((h & 0xFFFFFFFFULL) * slot_count) >> 32;
+}
@@ -0,0 +1,386 @@
+/*
+ * strpool_gen.c - [description]
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "strpool_gen.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct _scp_gen
+{
+  scp_frozen_t *base; /* May be `NULL` until the first merge */
+  strpool_t delta;
+
+  /* Observer of new strings, see `scp_gen_set_insert_hook(...)` */
+  scp_insert_hook_t hook;
+  void *hook_ctx;
+
+  /* State of the background merge, if `_merging` is set */
+  pthread_t _merger;
+  scp_frozen_t *_merged;
+  char *_snapshot;         /* Copy of the delta strings being folded */
+  size_t *_snapshot_at;    /* Offset of each string within `_snapshot` */
+  uint32_t *_snapshot_len; /* Length of each string (which may be a view) */
+  uint32_t _folded;        /* Number of delta strings being folded */
+  atomic_bool _done;
+  bool _merging;
+
+  bool _dynamic;
+};
+
+static inline uint32_t _scp_gen_base_size (scp_gen_t *gen);
+static void *_scp_gen_merger (void *arg);
+static const char *_scp_gen_source (void *ctx, uint32_t id, size_t *n);
+static void _scp_gen_inherit (strpool_t *delta, strpool_t *from);
+static void _scp_gen_hook (void *ctx, uint32_t id, const char *s,
+                           size_t len);
+
+/**
+ * @brief Terminates the program execution due to a critical exception.
+ *
+ * @param fmt Format string for the error message, followed by optional
+ * arguments.
+ * @param ... Optional arguments corresponding to the format string.
+ */
+static void
+_die (const char *fmt, ...)
+{
+  va_list arg;
+
+  va_start (arg, fmt);
+  vfprintf (stderr, fmt, arg);
+  fprintf (stderr, "\n");
+  va_end (arg);
+
+  exit (EXIT_FAILURE);
+}
+
+scp_gen_t *
+scp_gen_new ()
+{
+  scp_gen_t *gen = malloc (sizeof *gen);
+  if (!gen)
+    _die ("%s: Unable to allocate generational pool (errno=%d).", __func__,
+          errno);
+  gen->_dynamic = true;
+
+  return gen;
+}
+
+/**
+ * @brief Initializes a generational pool over an (optional) frozen base.
+ *
+ * @param gen The generational pool to initialize, either allocated by
+ * `scp_gen_new(...)` or `NULL` to allocate one.
+ * @param base The frozen base, whose ownership is transferred to the pool, or
+ * `NULL` to start from an empty base.
+ *
+ * @return The initialized generational pool.
+ */
+scp_gen_t *
+scp_gen_init (scp_gen_t *gen, scp_frozen_t *base)
+{
+  if (!gen) /* Ensure that the pool is properly allocated */
+    gen = scp_gen_new ();
+
+  gen->base = base;
+  gen->delta._dynamic = false;
+  scp_init (&gen->delta);
+  gen->hook = NULL, gen->hook_ctx = NULL;
+
+  gen->_merged = NULL, gen->_snapshot = NULL, gen->_snapshot_at = NULL;
+  gen->_snapshot_len = NULL;
+  gen->_folded = 0U, gen->_merging = false;
+  atomic_init (&gen->_done, false);
+  return gen;
+}
+
+void
+scp_gen_free (scp_gen_t *gen)
+{
+  if (gen->_merging) /* The merger still references the base */
+    scp_gen_merge_finish (gen, true);
+
+  if (gen->base)
+    scp_frozen_free (gen->base);
+  scp_free (&gen->delta);
+
+  if (gen->_dynamic)
+    free (gen);
+}
+
+/**
+ * @brief Interns a string, and retrieves its (stable) identifier.
+ *
+ * The base is searched first, so that only strings it lacks reach the delta.
+ *
+ * @param gen The generational pool to insert the string into.
+ * @param s The string to intern.
+ * @param n The maximum length of `s`, or `-1UL` if it is null-terminated.
+ *
+ * @return The identifier of the string.
+ */
+uint32_t
+scp_gen_insert (scp_gen_t *gen, const char *s, size_t n)
+{
+  uint32_t id = gen->base ? scp_frozen_lookup (gen->base, s, n)
+                          : SCP_INVALID_ID;
+
+  if (id != SCP_INVALID_ID)
+    return id;
+
+  id = scp_insert_id (&gen->delta, s, n);
+  if (id >= SCP_INVALID_ID - _scp_gen_base_size (gen))
+    _die ("%s: Generational pool identifiers have overflowed.", __func__);
+  return _scp_gen_base_size (gen) + id;
+}
+
+/**
+ * @brief Retrieves the identifier of a string without inserting it.
+ *
+ * @return The identifier of the string, or `SCP_INVALID_ID` if neither tier
+ * contains it.
+ */
+uint32_t
+scp_gen_lookup (scp_gen_t *gen, const char *s, size_t n)
+{
+  uint32_t id = gen->base ? scp_frozen_lookup (gen->base, s, n)
+                          : SCP_INVALID_ID;
+
+  if (id != SCP_INVALID_ID)
+    return id;
+
+  id = scp_lookup_id (&gen->delta, s, n);
+  return id == SCP_INVALID_ID ? id : _scp_gen_base_size (gen) + id;
+}
+
+/**
+ * @brief Resolves an identifier into its string, within either tier.
+ *
+ * Strings of the base remain valid until the next merge is finished, whereas
+ * strings of the delta follow the rules of `scp_string(...)`.
+ *
+ * @return The string, or `NULL` if the identifier is unknown.
+ */
+const char *
+scp_gen_string (scp_gen_t *gen, uint32_t id)
+{
+  uint32_t base_size = _scp_gen_base_size (gen);
+
+  if (id < base_size)
+    return scp_frozen_string (gen->base, id);
+  return scp_string (&gen->delta, id - base_size);
+}
+
+uint32_t
+scp_gen_size (scp_gen_t *gen)
+{
+  return _scp_gen_base_size (gen) + scp_size (&gen->delta);
+}
+
+/**
+ * @brief Retrieves the delta, so that its index may be tuned.
+ *
+ * The index settings (`scp_set_parameters(...)`, `scp_set_tuning(...)`,
+ * `scp_set_seed(...)`, `scp_set_filter(...)`, `scp_set_alignment(...)` and
+ * `scp_set_threads(...)`) carry over to the fresh delta installed by each
+ * merge, but the delta itself is replaced: the pointer is only valid until
+ * the next call to `scp_gen_merge_finish(...)`.
+ *
+ * Features keyed by the identifiers of the delta (insertion hooks, payloads,
+ * counting and fingerprints) aren't supported: those identifiers are local
+ * to the delta, restart at each merge, and the frozen base keeps nothing but
+ * strings. Such settings are dropped by merges; observe new strings through
+ * `scp_gen_set_insert_hook(...)` instead.
+ */
+strpool_t *
+scp_gen_delta (scp_gen_t *gen)
+{
+  return &gen->delta;
+}
+
+/**
+ * @brief Registers a callback observing every string added to the
+ * generational pool, such as an intern log (see `scp_log_append(...)`).
+ *
+ * The callback receives the identifiers of the generational pool, and
+ * remains registered across merges; strings carried over from one delta to
+ * the next by a merge aren't reported again.
+ *
+ * @param gen The generational pool to observe.
+ * @param hook The callback, or `NULL` to remove the current one.
+ * @param ctx An opaque pointer handed back to the callback.
+ */
+void
+scp_gen_set_insert_hook (scp_gen_t *gen, scp_insert_hook_t hook, void *ctx)
+{
+  gen->hook = hook, gen->hook_ctx = ctx;
+  scp_set_insert_hook (&gen->delta, hook ? _scp_gen_hook : NULL, gen);
+}
+
+/**
+ * @brief Starts folding the current delta into a new base, in the background.
+ *
+ * The delta strings are copied (the delta is expected to be small), so that
+ * the pool may keep serving lookups and insertions during the merge.
+ * Strings inserted in the meantime remain within the delta.
+ *
+ * @param gen The generational pool to merge.
+ *
+ * @return `true` if a merge was started, `false` if one is already running.
+ */
+bool
+scp_gen_merge_start (scp_gen_t *gen)
+{
+  strpool_t *delta = &gen->delta;
+  uint32_t i;
+
+  if (gen->_merging)
+    return false;
+
+  gen->_folded = scp_size (delta);
+  gen->_snapshot = malloc (delta->size);
+  gen->_snapshot_at = malloc ((gen->_folded + 1ULL) * sizeof (size_t));
+  gen->_snapshot_len = malloc ((gen->_folded + 1ULL) * sizeof (uint32_t));
+  if (!gen->_snapshot || !gen->_snapshot_at || !gen->_snapshot_len)
+    _die ("%s: Unable to allocate merge snapshot (errno=%d)", __func__,
+          errno);
+
+  memcpy (gen->_snapshot, delta->pool, delta->size);
+  for (i = 0U; i < gen->_folded; ++i)
+    {
+      gen->_snapshot_at[i] = delta->offsets[i];
+      gen->_snapshot_len[i] = (uint32_t)scp_length (delta, i);
+    }
+
+  atomic_store (&gen->_done, false);
+  if (pthread_create (&gen->_merger, NULL, _scp_gen_merger, gen) != 0)
+    _die ("%s: Unable to start merger thread (errno=%d)", __func__, errno);
+
+  gen->_merging = true;
+  return true;
+}
+
+/**
+ * @brief Installs the base built by the background merge.
+ *
+ * Strings inserted into the delta since the merge started are carried over
+ * into a fresh delta, in the same order, so that their identifiers persist.
+ *
+ * @param gen The generational pool being merged.
+ * @param wait Whether to block until the merger completes.
+ *
+ * @return `true` if the new base was installed, `false` if no merge was
+ * running, or (without `wait`) if it hasn't completed yet.
+ */
+bool
+scp_gen_merge_finish (scp_gen_t *gen, bool wait)
+{
+  strpool_t delta;
+  const char *s;
+  size_t len;
+  uint32_t i;
+
+  if (!gen->_merging || (!wait && !atomic_load (&gen->_done)))
+    return false;
+
+  pthread_join (gen->_merger, NULL);
+  gen->_merging = false;
+  free (gen->_snapshot), free (gen->_snapshot_at), free (gen->_snapshot_len);
+  gen->_snapshot = NULL, gen->_snapshot_at = NULL, gen->_snapshot_len = NULL;
+
+  delta._dynamic = false;
+  scp_init (&delta);
+  _scp_gen_inherit (&delta, &gen->delta);
+  for (i = gen->_folded; i < scp_size (&gen->delta); ++i)
+    {
+      s = scp_view (&gen->delta, i, &len);
+      scp_insert_bytes (&delta, s, len);
+    }
+
+  if (gen->base)
+    scp_frozen_free (gen->base);
+  scp_free (&gen->delta);
+
+  gen->base = gen->_merged, gen->_merged = NULL;
+  gen->delta = delta;
+  if (gen->hook) /* Only once the carried over strings are inserted */
+    scp_set_insert_hook (&gen->delta, _scp_gen_hook, gen);
+  return true;
+}
+
+/**
+ * @brief Folds the current delta into a new base, synchronously.
+ */
+void
+scp_gen_merge (scp_gen_t *gen)
+{
+  scp_gen_merge_finish (gen, true); /* Complete any pending merge first */
+  scp_gen_merge_start (gen);
+  scp_gen_merge_finish (gen, true);
+}
+
+static inline uint32_t
+_scp_gen_base_size (scp_gen_t *gen)
+{
+  return gen->base ? scp_frozen_size (gen->base) : 0U;
+}
+
+static void *
+_scp_gen_merger (void *arg)
+{
+  scp_gen_t *gen = arg;
+
+  gen->_merged = scp_frozen_build (_scp_gen_source, gen,
+                                   _scp_gen_base_size (gen) + gen->_folded);
+  atomic_store (&gen->_done, true);
+  return NULL;
+}
+
+/* Enumerates the base, followed by the snapshot of the delta */
+static const char *
+_scp_gen_source (void *ctx, uint32_t id, size_t *n)
+{
+  scp_gen_t *gen = ctx;
+  uint32_t base_size = _scp_gen_base_size (gen);
+
+  if (id < base_size)
+    {
+      *n = scp_frozen_length (gen->base, id);
+      return scp_frozen_string (gen->base, id);
+    }
+
+  *n = gen->_snapshot_len[id - base_size];
+  return gen->_snapshot + gen->_snapshot_at[id - base_size];
+}
+
+/* Carries the tuning of the previous delta over to a fresh (empty) one */
+static void
+_scp_gen_inherit (strpool_t *delta, strpool_t *from)
+{
+  const scp_set_t *index = &from->index;
+
+  scp_set_parameters (delta, index->load_factor, index->cellar_ratio);
+  scp_set_tuning (delta, index->tuning);
+  scp_set_seed (delta, index->seed);
+  scp_set_filter (delta, index->filter_bits);
+  scp_set_alignment (delta, from->alignment);
+  scp_set_threads (delta, index->threads);
+}
+
+/* Translates the identifiers of the delta into those of the pool */
+static void
+_scp_gen_hook (void *ctx, uint32_t id, const char *s, size_t len)
+{
+  scp_gen_t *gen = ctx;
+
+  gen->hook (gen->hook_ctx, _scp_gen_base_size (gen) + id, s, len);
+}
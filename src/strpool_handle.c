@@ -0,0 +1,133 @@
+/*
+ * strpool_handle.c - [description]
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#define _POSIX_C_SOURCE 200809L /* strnlen(...) */
+
+#include "strpool_handle.h"
+
+#include <string.h>
+
+#define SCP_HANDLE_INLINE_TAG 0x80U /* Tag byte of inline handles */
+
+static inline scp_handle_t _scp_handle_pack (const char *s, size_t len);
+
+/**
+ * @brief Retrieves the handle of a string, interning it if it is too long to
+ * be inlined.
+ *
+ * @param pool The string pool receiving long strings.
+ * @param s The string.
+ * @param n The maximum length of `s`, or `-1UL` if it is null-terminated.
+ *
+ * @return The handle of the string.
+ */
+scp_handle_t
+scp_handle_insert (strpool_t *pool, const char *s, size_t n)
+{
+  size_t len = n == -1UL ? strlen (s) : strnlen (s, n);
+
+  if (len <= SCP_HANDLE_INLINE_MAX)
+    return _scp_handle_pack (s, len);
+  return scp_insert_bytes (pool, s, len);
+}
+
+/**
+ * @brief Retrieves the handle of a string without interning it.
+ *
+ * Short strings always have a handle, whether or not the pool contains them.
+ *
+ * @return The handle of the string, or `SCP_INVALID_HANDLE` if the string is
+ * long and missing from the pool.
+ */
+scp_handle_t
+scp_handle_lookup (strpool_t *pool, const char *s, size_t n)
+{
+  size_t len = n == -1UL ? strlen (s) : strnlen (s, n);
+  uint32_t id;
+
+  if (len <= SCP_HANDLE_INLINE_MAX)
+    return _scp_handle_pack (s, len);
+
+  id = scp_lookup_bytes (pool, s, len);
+  return id == SCP_INVALID_ID ? SCP_INVALID_HANDLE : id;
+}
+
+bool
+scp_handle_is_inline (scp_handle_t handle)
+{
+  return handle != SCP_INVALID_HANDLE
+         && (handle >> 56 & SCP_HANDLE_INLINE_TAG);
+}
+
+/**
+ * @brief Retrieves the pool identifier carried by a handle.
+ *
+ * @return The identifier, or `SCP_INVALID_ID` for inline (and invalid)
+ * handles.
+ */
+uint32_t
+scp_handle_id (scp_handle_t handle)
+{
+  return handle >> 56 ? SCP_INVALID_ID : (uint32_t)handle;
+}
+
+size_t
+scp_handle_length (strpool_t *pool, scp_handle_t handle)
+{
+  if (handle == SCP_INVALID_HANDLE)
+    return 0UL;
+  if (scp_handle_is_inline (handle))
+    return handle >> 56 & ~SCP_HANDLE_INLINE_TAG;
+  return scp_length (pool, scp_handle_id (handle));
+}
+
+/**
+ * @brief Copies the string of a handle into a caller buffer.
+ *
+ * @param pool The string pool holding long strings.
+ * @param handle The handle of the string.
+ * @param buf The buffer receiving the null-terminated string, truncated if
+ * it doesn't fit (may be `NULL` if `size` is zero).
+ * @param size The size of `buf`, in bytes.
+ *
+ * @return The length of the full string (excluding the terminator), as with
+ * `snprintf(...)`.
+ */
+size_t
+scp_handle_copy (strpool_t *pool, scp_handle_t handle, char *buf,
+                 size_t size)
+{
+  size_t len = scp_handle_length (pool, handle), i, end;
+  const char *s;
+
+  if (!size)
+    return len;
+
+  end = len < size - 1UL ? len : size - 1UL;
+  if (scp_handle_is_inline (handle))
+    for (i = 0UL; i < end; ++i)
+      buf[i] = (char)(handle >> (8U * i));
+  else if (end)
+    {
+      s = scp_view (pool, scp_handle_id (handle), NULL);
+      memcpy (buf, s, end);
+    }
+
+  buf[end] = '\0';
+  return len;
+}
+
+/* Packs a short string, byte `i` at bit `8 * i`, whatever the endianness */
+static inline scp_handle_t
+_scp_handle_pack (const char *s, size_t len)
+{
+  scp_handle_t handle = (scp_handle_t)(SCP_HANDLE_INLINE_TAG | len) << 56;
+  size_t i;
+
+  for (i = 0UL; i < len; ++i)
+    handle |= (scp_handle_t)(uint8_t)s[i] << (8U * i);
+  return handle;
+}
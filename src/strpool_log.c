@@ -0,0 +1,570 @@
+/*
+ * strpool_log.c - [description]
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#define _POSIX_C_SOURCE 200809L /* pread(...), fdatasync(...), etc. */
+
+#include "strpool_log.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SCP_LOG_MAGIC "SCPLOG\0\1"
+#define SCP_LOG_SEED 0x10C0FFEE5CA1AB1EULL
+
+#define SCP_LOG_BUFFER_SIZE (64UL << 10) /* Bytes written per batch */
+#define SCP_LOG_READ_SIZE (256UL << 10)  /* Bytes read per poll attempt */
+
+/* Header of each record, followed by the `len` bytes of its string */
+struct _scp_log_record
+{
+  uint32_t id;
+  uint32_t len;
+  uint64_t check; /* Hash of the identifier, the length and the bytes */
+};
+
+static void _scp_log_hook (void *ctx, uint32_t id, const char *s,
+                           size_t len);
+static bool _scp_log_write (scp_log_t *log);
+static bool _scp_log_write_all (int fd, const char *buf, size_t size);
+static uint64_t _scp_log_now (void);
+static uint64_t _scp_log_check (uint32_t id, const char *s, uint32_t len);
+static scp_log_follower_t *_scp_log_follower (int fd);
+static uint32_t _scp_log_read (scp_log_follower_t *follower,
+                               strpool_t *pool);
+
+/**
+ * @brief Terminates the program execution due to a critical exception.
+ *
+ * @param fmt Format string for the error message, followed by optional
+ * arguments.
+ * @param ... Optional arguments corresponding to the format string.
+ */
+static void
+_die (const char *fmt, ...)
+{
+  va_list arg;
+
+  va_start (arg, fmt);
+  vfprintf (stderr, fmt, arg);
+  fprintf (stderr, "\n");
+  va_end (arg);
+
+  exit (EXIT_FAILURE);
+}
+
+/**
+ * @brief Opens (or creates) an intern log for appending.
+ *
+ * A torn record left at the end of the log by a crash is truncated, so that
+ * new records directly follow the last complete one.
+ *
+ * @param path The path of the log.
+ * @param group The number of records per group commit (at least one).
+ * @param sync Whether group commits flush the log to stable storage.
+ *
+ * @return The log, to be released with `scp_log_close(...)`, or `NULL` (with
+ * `errno` set) if the file couldn't be opened or isn't an intern log.
+ */
+scp_log_t *
+scp_log_open (const char *path, uint32_t group, bool sync)
+{
+  scp_log_follower_t *scan;
+  scp_log_t *log;
+  struct stat st;
+  char magic[8];
+  int fd = open (path, O_RDWR | O_CREAT | O_APPEND, 0644), error;
+
+  if (fd < 0)
+    return NULL;
+  if (fstat (fd, &st) < 0)
+    goto fail;
+
+  if (!st.st_size)
+    {
+      if (write (fd, SCP_LOG_MAGIC, sizeof (magic)) != sizeof (magic)
+          || (sync && fsync (fd) < 0))
+        goto fail;
+    }
+  else
+    {
+      if (pread (fd, magic, sizeof (magic), 0) != sizeof (magic)
+          || memcmp (magic, SCP_LOG_MAGIC, sizeof (magic)))
+        {
+          errno = EINVAL;
+          goto fail;
+        }
+
+      /* Find the end of the last complete record, and drop what follows */
+      scan = _scp_log_follower (fd);
+      if (_scp_log_read (scan, NULL) == SCP_INVALID_ID
+          || (scan->offset < (uint64_t)st.st_size
+              && ftruncate (fd, scan->offset) < 0))
+        {
+          error = errno;
+          free (scan->buffer), free (scan);
+          errno = error;
+          goto fail;
+        }
+      free (scan->buffer), free (scan);
+    }
+
+  log = malloc (sizeof (*log));
+  if (!log)
+    _die ("%s: Unable to allocate log (errno=%d)", __func__, errno);
+
+  log->fd = fd, log->sync = sync, log->error = 0;
+  log->group = group ? group : 1U, log->pending = 0U;
+  log->delay = SCP_LOG_DEFAULT_DELAY * 1000000ULL, log->since = 0U;
+  log->buffer_size = 0UL, log->buffer_capacity = SCP_LOG_BUFFER_SIZE;
+  log->buffer = malloc (log->buffer_capacity);
+  if (!log->buffer)
+    _die ("%s: Unable to allocate log->buffer (errno=%d)", __func__, errno);
+  return log;
+
+fail:
+  error = errno;
+  close (fd);
+  errno = error;
+  return NULL;
+}
+
+/**
+ * @brief Commits the pending records, and closes the log.
+ *
+ * @return `true` if every record was written, `false` otherwise. The log is
+ * released regardless.
+ */
+bool
+scp_log_close (scp_log_t *log)
+{
+  bool committed = scp_log_commit (log);
+
+  close (log->fd);
+  free (log->buffer);
+  free (log);
+  return committed;
+}
+
+/**
+ * @brief Records every string subsequently added to a pool within a log.
+ *
+ * The pool should already hold the strings preceding the log (its snapshot,
+ * followed by the replay of the log itself, see `scp_log_replay(...)`).
+ */
+void
+scp_log_attach (scp_log_t *log, strpool_t *pool)
+{
+  scp_set_insert_hook (pool, _scp_log_hook, log);
+}
+
+/**
+ * @brief Bounds the time a buffered record may wait for its group commit.
+ *
+ * @param log The intern log.
+ * @param delay_ms The delay, in milliseconds, or zero to commit on the
+ * number and size of records only.
+ */
+void
+scp_log_set_delay (scp_log_t *log, uint32_t delay_ms)
+{
+  log->delay = delay_ms * 1000000ULL;
+}
+
+/**
+ * @brief Appends a record to the log.
+ *
+ * The record is buffered, and only written once the group is complete, the
+ * buffer is full, or the delay of the log has elapsed (see above). After a
+ * write error, records are dropped (so that the log remains a gapless prefix
+ * of the pool) until the error is reported by `scp_log_commit(...)`.
+ */
+void
+scp_log_append (scp_log_t *log, uint32_t id, const char *s, size_t len)
+{
+  struct _scp_log_record record = { id, len, 0U };
+  size_t size = sizeof (record) + len;
+  uint64_t now = log->delay ? _scp_log_now () : 0U;
+
+  if (log->error)
+    return;
+  if (len > UINT32_MAX)
+    {
+      log->error = EOVERFLOW;
+      return;
+    }
+
+  if (log->buffer_size + size > log->buffer_capacity)
+    {
+      if (!scp_log_commit (log))
+        return;
+      if (size > log->buffer_capacity)
+        {
+          log->buffer_capacity = size;
+          free (log->buffer);
+          log->buffer = malloc (log->buffer_capacity);
+          if (!log->buffer)
+            _die ("%s: Unable to allocate log->buffer (errno=%d)", __func__,
+                  errno);
+        }
+    }
+
+  record.check = _scp_log_check (id, s, len);
+  memcpy (log->buffer + log->buffer_size, &record, sizeof (record));
+  memcpy (log->buffer + log->buffer_size + sizeof (record), s, len);
+  log->buffer_size += size;
+
+  if (!log->pending++)
+    log->since = now;
+  if (log->pending >= log->group
+      || (log->delay && now - log->since >= log->delay))
+    scp_log_commit (log);
+}
+
+/**
+ * @brief Writes the pending records, flushing them if the log syncs.
+ *
+ * @return `true` if every record appended so far was written, `false` (with
+ * `errno` set) if the log failed at some point.
+ */
+bool
+scp_log_commit (scp_log_t *log)
+{
+  log->pending = 0U;
+  if (_scp_log_write (log) && log->sync && fdatasync (log->fd) < 0)
+    log->error = errno;
+
+  if (log->error)
+    errno = log->error;
+  return !log->error;
+}
+
+/**
+ * @brief Writes the first strings of a pool as a complete log, which
+ * `scp_log_replay(...)` loads back under the same identifiers.
+ *
+ * Nothing is allocated, and no lock is taken, so that the child of a
+ * multithreaded process may dump its pool after `fork(...)` (see
+ * `scp_snapshot_async(...)`).
+ *
+ * @param pool The string pool to dump.
+ * @param size The number of strings to dump, from identifier zero.
+ * @param fd The file to write the log to, at its current offset.
+ * @param buffer A staging buffer for the records; strings that don't fit are
+ * written straight from the pool.
+ * @param capacity The size of `buffer`, at least `SCP_LOG_DUMP_MIN_BUFFER`.
+ *
+ * @return `true` if the log was written, `false` (with `errno` set)
+ * otherwise.
+ */
+bool
+scp_log_dump (strpool_t *pool, uint32_t size, int fd, char *buffer,
+              size_t capacity)
+{
+  struct _scp_log_record record;
+  size_t used = sizeof (SCP_LOG_MAGIC) - 1UL, len;
+  const char *s;
+  uint32_t id;
+
+  memcpy (buffer, SCP_LOG_MAGIC, used);
+  for (id = 0U; id < size; ++id)
+    {
+      s = scp_view (pool, id, &len);
+      record.id = id, record.len = len;
+      record.check = _scp_log_check (id, s, len);
+
+      if (used + sizeof (record) > capacity)
+        {
+          if (!_scp_log_write_all (fd, buffer, used))
+            return false;
+          used = 0UL;
+        }
+      memcpy (buffer + used, &record, sizeof (record));
+      used += sizeof (record);
+
+      if (used + len <= capacity)
+        {
+          memcpy (buffer + used, s, len);
+          used += len;
+        }
+      else if (!_scp_log_write_all (fd, buffer, used)
+               || !_scp_log_write_all (fd, s, len))
+        return false;
+      else
+        used = 0UL;
+    }
+  return _scp_log_write_all (fd, buffer, used);
+}
+
+/**
+ * @brief Opens a log for reading, from its first record.
+ *
+ * @return The follower, to be released with `scp_log_unfollow(...)`, or
+ * `NULL` (with `errno` set) if the file couldn't be opened or isn't an intern
+ * log.
+ */
+scp_log_follower_t *
+scp_log_follow (const char *path)
+{
+  char magic[8];
+  int fd = open (path, O_RDONLY);
+
+  if (fd < 0)
+    return NULL;
+  if (pread (fd, magic, sizeof (magic), 0) != sizeof (magic)
+      || memcmp (magic, SCP_LOG_MAGIC, sizeof (magic)))
+    {
+      close (fd);
+      errno = EINVAL;
+      return NULL;
+    }
+  return _scp_log_follower (fd);
+}
+
+/**
+ * @brief Applies the records appended to the log since the last poll.
+ *
+ * Records whose identifier the pool already holds are skipped, so a follower
+ * may start from any snapshot of the pool older than the log's end. Records
+ * still being written are left for the next poll. The insertion hook of the
+ * pool is suspended meanwhile, so that replayed strings aren't logged again.
+ *
+ * @param follower The follower of the log.
+ * @param pool The pool to bring up to date.
+ *
+ * @return The number of records applied, or `SCP_INVALID_ID` (with `errno`
+ * set) if the log couldn't be read, or doesn't extend the pool.
+ */
+uint32_t
+scp_log_poll (scp_log_follower_t *follower, strpool_t *pool)
+{
+  scp_insert_hook_t hook = pool->insert_hook;
+  void *ctx = pool->insert_hook_ctx;
+  uint32_t applied;
+
+  scp_set_insert_hook (pool, NULL, NULL);
+  applied = _scp_log_read (follower, pool);
+  scp_set_insert_hook (pool, hook, ctx);
+  return applied;
+}
+
+void
+scp_log_unfollow (scp_log_follower_t *follower)
+{
+  close (follower->fd);
+  free (follower->buffer);
+  free (follower);
+}
+
+/**
+ * @brief Replays a whole log onto a pool, see `scp_log_poll(...)`.
+ *
+ * @return The number of records applied, or `SCP_INVALID_ID` (with `errno`
+ * set) on failure.
+ */
+uint32_t
+scp_log_replay (strpool_t *pool, const char *path)
+{
+  scp_log_follower_t *follower = scp_log_follow (path);
+  uint32_t applied;
+
+  if (!follower)
+    return SCP_INVALID_ID;
+
+  applied = scp_log_poll (follower, pool);
+  scp_log_unfollow (follower);
+  return applied;
+}
+
+/**
+ * @brief Rebuilds a pool from its latest snapshot and its intern log.
+ *
+ * @param snapshot The path of the snapshot (see `scp_snapshot_async(...)`),
+ * or `NULL` if the log starts from an empty pool. A missing snapshot is
+ * treated as empty.
+ * @param path The path of the log (or `NULL` to only load the snapshot),
+ * whose records preceding the end of the snapshot are skipped.
+ *
+ * @return The recovered pool, to be released with `scp_free(...)`, or `NULL`
+ * (with `errno` set) if either file couldn't be read, or if the log doesn't
+ * extend the snapshot.
+ */
+strpool_t *
+scp_log_recover (const char *snapshot, const char *path)
+{
+  strpool_t *pool = scp_init (NULL);
+  int error;
+
+  if (snapshot && scp_log_replay (pool, snapshot) == SCP_INVALID_ID
+      && errno != ENOENT)
+    goto fail;
+  if (path && scp_log_replay (pool, path) == SCP_INVALID_ID)
+    goto fail;
+  return pool;
+
+fail:
+  error = errno;
+  scp_free (pool);
+  errno = error;
+  return NULL;
+}
+
+static void
+_scp_log_hook (void *ctx, uint32_t id, const char *s, size_t len)
+{
+  scp_log_append (ctx, id, s, len);
+}
+
+/* Writes the buffered records */
+static bool
+_scp_log_write (scp_log_t *log)
+{
+  if (!log->error
+      && !_scp_log_write_all (log->fd, log->buffer, log->buffer_size))
+    log->error = errno;
+
+  log->buffer_size = 0UL;
+  return !log->error;
+}
+
+/* Writes a whole buffer, retrying short and interrupted writes */
+static bool
+_scp_log_write_all (int fd, const char *buf, size_t size)
+{
+  size_t done = 0UL;
+  ssize_t written;
+
+  while (done < size)
+    {
+      written = write (fd, buf + done, size - done);
+      if (written < 0 && errno != EINTR)
+        return false;
+      if (written > 0)
+        done += written;
+    }
+  return true;
+}
+
+static uint64_t
+_scp_log_check (uint32_t id, const char *s, uint32_t len)
+{
+  return scp_hash64 (s, len, SCP_LOG_SEED ^ id ^ ((uint64_t)len << 32));
+}
+
+/* Reads a monotonic clock, in nanoseconds */
+static uint64_t
+_scp_log_now (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static scp_log_follower_t *
+_scp_log_follower (int fd)
+{
+  scp_log_follower_t *follower = malloc (sizeof (*follower));
+
+  if (!follower)
+    _die ("%s: Unable to allocate follower (errno=%d)", __func__, errno);
+
+  follower->fd = fd, follower->offset = sizeof (SCP_LOG_MAGIC) - 1UL;
+  follower->buffer_capacity = SCP_LOG_READ_SIZE;
+  follower->buffer = malloc (follower->buffer_capacity);
+  if (!follower->buffer)
+    _die ("%s: Unable to allocate follower->buffer (errno=%d)", __func__,
+          errno);
+  return follower;
+}
+
+/**
+ * @brief Reads the complete records following the offset of a follower.
+ *
+ * The log is read in large chunks; a record straddling the end of a chunk is
+ * read again at the start of the next one. Reading stops at the first
+ * incomplete (or corrupted) record, which is where the follower resumes.
+ *
+ * @param follower The follower of the log.
+ * @param pool The pool to apply the records to, or `NULL` to merely skip
+ * them.
+ */
+static uint32_t
+_scp_log_read (scp_log_follower_t *follower, strpool_t *pool)
+{
+  struct _scp_log_record record;
+  uint32_t applied = 0U;
+  size_t at, size, need = 0UL;
+  struct stat st;
+  char *buffer;
+  ssize_t got;
+
+  for (;;)
+    {
+      got = pread (follower->fd, follower->buffer, follower->buffer_capacity,
+                   follower->offset);
+      if (got < 0)
+        return SCP_INVALID_ID;
+
+      for (at = 0UL, size = got; at + sizeof (record) <= size; at += need)
+        {
+          memcpy (&record, follower->buffer + at, sizeof (record));
+          need = sizeof (record) + record.len;
+          if (at + need > size)
+            break;
+
+          if (record.check
+              != _scp_log_check (record.id,
+                                 follower->buffer + at + sizeof (record),
+                                 record.len))
+            {
+              follower->offset += at;
+              return applied;
+            }
+
+          if (pool && record.id >= scp_size (pool))
+            {
+              if (record.id > scp_size (pool)
+                  || scp_insert_bytes (pool,
+                                       follower->buffer + at + sizeof (record),
+                                       record.len)
+                         != record.id)
+                {
+                  follower->offset += at;
+                  errno = EINVAL;
+                  return SCP_INVALID_ID;
+                }
+              applied++;
+            }
+        }
+      follower->offset += at;
+
+      if (size < follower->buffer_capacity)
+        return applied; /* Reached the end of the log */
+      if (!at)
+        {
+          /* A single record exceeds the buffer. Its length isn't checked
+             yet, so it is only trusted if the log holds the whole record:
+             otherwise, the record is torn (or still being written). */
+          if (fstat (follower->fd, &st) < 0)
+            return SCP_INVALID_ID;
+          if (follower->offset + need > (uint64_t)st.st_size)
+            return applied;
+
+          buffer = malloc (need);
+          if (!buffer)
+            return SCP_INVALID_ID; /* Retried by the next poll */
+          free (follower->buffer);
+          follower->buffer = buffer, follower->buffer_capacity = need;
+        }
+    }
+}
@@ -0,0 +1,286 @@
+/*
+ * strpool_path.c - [description]
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#define _POSIX_C_SOURCE 200809L /* strnlen(...) */
+
+#include "strpool_path.h"
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t _scp_path_walk (scp_path_t *paths, const char *s, size_t n,
+                                bool create);
+static uint32_t _scp_path_node (scp_path_t *paths, uint32_t parent,
+                                const char *s, size_t len, bool create);
+
+/**
+ * @brief Terminates the program execution due to a critical exception.
+ *
+ * @param fmt Format string for the error message, followed by optional
+ * arguments.
+ * @param ... Optional arguments corresponding to the format string.
+ */
+static void
+_die (const char *fmt, ...)
+{
+  va_list arg;
+
+  va_start (arg, fmt);
+  vfprintf (stderr, fmt, arg);
+  fprintf (stderr, "\n");
+  va_end (arg);
+
+  exit (EXIT_FAILURE);
+}
+
+scp_path_t *
+scp_path_new ()
+{
+  scp_path_t *paths = malloc (sizeof *paths);
+  if (!paths)
+    _die ("%s: Unable to allocate path pool (errno=%d).", __func__, errno);
+  paths->_dynamic = true;
+
+  return paths;
+}
+
+/**
+ * @brief Initializes an empty path pool.
+ *
+ * @param paths The path pool to initialize, or `NULL` to allocate one.
+ * @param separator The character separating components, such as '/' or '.'.
+ *
+ * @return The initialized path pool.
+ */
+scp_path_t *
+scp_path_init (scp_path_t *paths, char separator)
+{
+  if (!paths) /* Ensure that the pool is properly allocated */
+    paths = scp_path_new ();
+
+  paths->components._dynamic = false;
+  scp_init (&paths->components);
+  paths->nodes._dynamic = false;
+  scp_tuple_init (&paths->nodes, 2U);
+  paths->separator = separator;
+  return paths;
+}
+
+void
+scp_path_free (scp_path_t *paths)
+{
+  scp_free (&paths->components);
+  scp_tuple_free (&paths->nodes);
+
+  if (paths->_dynamic)
+    free (paths);
+}
+
+/**
+ * @brief Interns a path (and each of its prefixes), and retrieves its
+ * identifier.
+ *
+ * @param paths The path pool to insert the path into.
+ * @param s The path to intern.
+ * @param n The maximum length of `s`, or `-1UL` if it is null-terminated.
+ *
+ * @return The identifier of the path.
+ */
+uint32_t
+scp_path_insert (scp_path_t *paths, const char *s, size_t n)
+{
+  return _scp_path_walk (paths, s, n, true);
+}
+
+/**
+ * @brief Retrieves the identifier of a path without inserting it.
+ *
+ * @return The identifier of the path, or `SCP_INVALID_ID` if the pool doesn't
+ * contain it.
+ */
+uint32_t
+scp_path_lookup (scp_path_t *paths, const char *s, size_t n)
+{
+  return _scp_path_walk (paths, s, n, false);
+}
+
+/**
+ * @brief Reconstructs a path into a caller buffer.
+ *
+ * The path is measured by a first walk towards the root, and then written
+ * backwards by a second one, so no intermediate storage is needed.
+ *
+ * @param paths The path pool.
+ * @param id The identifier of the path.
+ * @param buf The buffer receiving the null-terminated path, truncated if it
+ * doesn't fit (may be `NULL` if `size` is zero).
+ * @param size The size of `buf`, in bytes.
+ *
+ * @return The length of the full path (excluding the terminator), as with
+ * `snprintf(...)`.
+ */
+size_t
+scp_path_string (scp_path_t *paths, uint32_t id, char *buf, size_t size)
+{
+  const char *component;
+  size_t len = 0UL, at, end, n;
+  uint32_t node;
+
+  for (node = id; node != SCP_INVALID_ID; node = scp_path_parent (paths, node))
+    len += strlen (scp_path_component (paths, node)) + 1UL;
+  len = len ? len - 1UL : 0UL; /* No separator before the first component */
+
+  if (!size)
+    return len;
+
+  end = len < size - 1UL ? len : size - 1UL;
+  buf[end] = '\0';
+  for (at = len, node = id; node != SCP_INVALID_ID;
+       node = scp_path_parent (paths, node))
+    {
+      component = scp_path_component (paths, node);
+      n = strlen (component);
+      at -= n;
+      if (at < end)
+        memcpy (buf + at, component, (end - at < n ? end - at : n));
+      if (at > 0UL && --at < end)
+        buf[at] = paths->separator;
+    }
+  return len;
+}
+
+uint32_t
+scp_path_size (scp_path_t *paths)
+{
+  return scp_tuple_size (&paths->nodes);
+}
+
+/**
+ * @brief Interns a single component below a path.
+ *
+ * @param paths The path pool.
+ * @param parent The identifier of the parent path, or `SCP_INVALID_ID` for a
+ * top-level component.
+ * @param s The component, which shouldn't contain the separator.
+ * @param n The maximum length of `s`, or `-1UL` if it is null-terminated.
+ *
+ * @return The identifier of the child path.
+ */
+uint32_t
+scp_path_child (scp_path_t *paths, uint32_t parent, const char *s, size_t n)
+{
+  return _scp_path_node (paths, parent, s,
+                         n == -1UL ? strlen (s) : strnlen (s, n), true);
+}
+
+/**
+ * @brief Retrieves a single component below a path, without inserting it.
+ *
+ * @return The identifier of the child path, or `SCP_INVALID_ID` if the pool
+ * doesn't contain it.
+ */
+uint32_t
+scp_path_find_child (scp_path_t *paths, uint32_t parent, const char *s,
+                     size_t n)
+{
+  return _scp_path_node (paths, parent, s,
+                         n == -1UL ? strlen (s) : strnlen (s, n), false);
+}
+
+/**
+ * @brief Retrieves the parent of a path.
+ *
+ * @return The identifier of the parent, or `SCP_INVALID_ID` for top-level
+ * components and unknown identifiers.
+ */
+uint32_t
+scp_path_parent (scp_path_t *paths, uint32_t id)
+{
+  const uint32_t *node = scp_tuple_get (&paths->nodes, id, NULL);
+  return node ? node[0] : SCP_INVALID_ID;
+}
+
+/**
+ * @brief Retrieves the last component of a path.
+ *
+ * @return The pooled component, or `NULL` if the identifier is unknown.
+ */
+const char *
+scp_path_component (scp_path_t *paths, uint32_t id)
+{
+  const uint32_t *node = scp_tuple_get (&paths->nodes, id, NULL);
+  return node ? scp_string (&paths->components, node[1]) : NULL;
+}
+
+/* Counts the components of a path (one for top-level components) */
+uint32_t
+scp_path_depth (scp_path_t *paths, uint32_t id)
+{
+  uint32_t depth = 0U;
+
+  for (; id != SCP_INVALID_ID; id = scp_path_parent (paths, id))
+    depth++;
+  return depth;
+}
+
+/**
+ * @brief Determines whether a path starts with the components of another.
+ *
+ * @return `true` if `prefix` is `id` or one of its ancestors, `false`
+ * otherwise.
+ */
+bool
+scp_path_has_prefix (scp_path_t *paths, uint32_t id, uint32_t prefix)
+{
+  for (; id != SCP_INVALID_ID; id = scp_path_parent (paths, id))
+    if (id == prefix)
+      return true;
+  return false;
+}
+
+/* Walks (or builds) the nodes of a path, one component at a time */
+static uint32_t
+_scp_path_walk (scp_path_t *paths, const char *s, size_t n, bool create)
+{
+  size_t len = n == -1UL ? strlen (s) : strnlen (s, n), start = 0UL, end;
+  const char *sep;
+  uint32_t node = SCP_INVALID_ID;
+
+  do
+    {
+      sep = memchr (s + start, paths->separator, len - start);
+      end = sep ? (size_t)(sep - s) : len;
+      node = _scp_path_node (paths, node, s + start, end - start, create);
+      if (node == SCP_INVALID_ID)
+        return SCP_INVALID_ID;
+      start = end + 1UL;
+    }
+  while (sep);
+
+  return node;
+}
+
+/* Resolves the node of a (parent, component) pair, inserting it if asked */
+static uint32_t
+_scp_path_node (scp_path_t *paths, uint32_t parent, const char *s,
+                size_t len, bool create)
+{
+  uint32_t node[2] = { parent, SCP_INVALID_ID };
+
+  if (create)
+    {
+      node[1] = scp_insert_bytes (&paths->components, s, len);
+      return scp_tuple_insert (&paths->nodes, node, 2U);
+    }
+
+  node[1] = scp_lookup_bytes (&paths->components, s, len);
+  if (node[1] == SCP_INVALID_ID)
+    return SCP_INVALID_ID;
+  return scp_tuple_lookup (&paths->nodes, node, 2U);
+}
@@ -0,0 +1,192 @@
+/*
+ * strpool_snapshot.c - [description]
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#define _POSIX_C_SOURCE 200809L /* strdup(...), strndup(...) */
+
+#include "strpool_snapshot.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "strpool_log.h"
+
+#define SCP_SNAPSHOT_WRITE_SIZE (8UL << 20) /* Bytes per write(...) */
+
+static bool _scp_snapshot_write (strpool_t *pool, scp_snapshot_t *snapshot);
+static bool _scp_snapshot_sync_dir (const char *path);
+
+/**
+ * @brief Terminates the program execution due to a critical exception.
+ *
+ * @param fmt Format string for the error message, followed by optional
+ * arguments.
+ * @param ... Optional arguments corresponding to the format string.
+ */
+static void
+_die (const char *fmt, ...)
+{
+  va_list arg;
+
+  va_start (arg, fmt);
+  vfprintf (stderr, fmt, arg);
+  fprintf (stderr, "\n");
+  va_end (arg);
+
+  exit (EXIT_FAILURE);
+}
+
+/**
+ * @brief Starts writing a snapshot of a pool to `path`, in the background.
+ *
+ * Only the `fork(...)` itself (which copies the page tables, not the pages)
+ * runs on the caller's thread; the pool may be modified as soon as this
+ * function returns. The child writes the image under a temporary name from a
+ * buffer allocated beforehand, as the threads of the library (parallel
+ * rehashing, generational merges) may hold the allocator's locks at the time
+ * of the fork. `scp_snapshot_finish(...)` then renames it over `path`, so
+ * `path` always holds a complete snapshot.
+ *
+ * As with any `fork(...)`, the parent's memory use grows with the pages it
+ * modifies while the snapshot runs (at most the size of the pool).
+ *
+ * @param pool The string pool to snapshot.
+ * @param path The path of the snapshot.
+ *
+ * @return The running snapshot, to be completed by `scp_snapshot_finish(...)`,
+ * or `NULL` (with `errno` set) if no child could be started.
+ */
+scp_snapshot_t *
+scp_snapshot_async (strpool_t *pool, const char *path)
+{
+  scp_snapshot_t *snapshot = malloc (sizeof (*snapshot));
+  int error;
+
+  if (!snapshot)
+    _die ("%s: Unable to allocate snapshot (errno=%d)", __func__, errno);
+
+  snapshot->path = strdup (path);
+  snapshot->tmp = malloc (strlen (path) + sizeof (".tmp"));
+  snapshot->buffer = malloc (SCP_SNAPSHOT_WRITE_SIZE);
+  if (!snapshot->path || !snapshot->tmp || !snapshot->buffer)
+    _die ("%s: Unable to allocate snapshot buffers (errno=%d)", __func__,
+          errno);
+  strcat (strcpy (snapshot->tmp, path), ".tmp");
+
+  snapshot->size = scp_size (pool);
+  snapshot->pid = fork ();
+  if (snapshot->pid < 0)
+    {
+      error = errno;
+      free (snapshot->path), free (snapshot->tmp), free (snapshot->buffer);
+      free (snapshot);
+      errno = error;
+      return NULL;
+    }
+
+  /* The child must not run the parent's exit handlers, nor flush its stdio
+     buffers a second time */
+  if (!snapshot->pid)
+    _exit (_scp_snapshot_write (pool, snapshot) ? EXIT_SUCCESS
+                                                : EXIT_FAILURE);
+  return snapshot;
+}
+
+/**
+ * @brief Collects the outcome of a background snapshot.
+ *
+ * Once the child has written the image, it is renamed over the path of the
+ * snapshot, and the directory is flushed so that the rename itself survives
+ * a crash.
+ *
+ * @param snapshot The snapshot, released unless it is still running.
+ * @param wait Whether to block until the snapshot is written.
+ *
+ * @return `SCP_SNAPSHOT_RUNNING` if the snapshot is still being written
+ * (only without `wait`), `SCP_SNAPSHOT_DONE` once it is durable at its path,
+ * or `SCP_SNAPSHOT_FAILED` if it couldn't be written.
+ */
+scp_snapshot_status_t
+scp_snapshot_finish (scp_snapshot_t *snapshot, bool wait)
+{
+  bool done;
+  pid_t pid;
+  int status;
+
+  do
+    pid = waitpid (snapshot->pid, &status, wait ? 0 : WNOHANG);
+  while (pid < 0 && errno == EINTR);
+
+  if (!pid)
+    return SCP_SNAPSHOT_RUNNING;
+
+  done = pid > 0 && WIFEXITED (status) && WEXITSTATUS (status) == EXIT_SUCCESS
+         && rename (snapshot->tmp, snapshot->path) == 0;
+  if (done)
+    done = _scp_snapshot_sync_dir (snapshot->path);
+  else
+    unlink (snapshot->tmp);
+
+  free (snapshot->path), free (snapshot->tmp), free (snapshot->buffer);
+  free (snapshot);
+  return done ? SCP_SNAPSHOT_DONE : SCP_SNAPSHOT_FAILED;
+}
+
+/**
+ * @brief Runs within the child: dumps the pool into the temporary file.
+ *
+ * Only async-signal-safe calls are made (no allocation, no stdio), as the
+ * child of a multithreaded process may find their locks held forever.
+ */
+static bool
+_scp_snapshot_write (strpool_t *pool, scp_snapshot_t *snapshot)
+{
+  int fd = open (snapshot->tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+  if (fd < 0)
+    return false;
+
+  /* Large sequential writes, so that the kernel streams the image out */
+  if (!scp_log_dump (pool, snapshot->size, fd, snapshot->buffer,
+                     SCP_SNAPSHOT_WRITE_SIZE)
+      || fsync (fd) < 0)
+    {
+      close (fd);
+      return false;
+    }
+  return close (fd) == 0;
+}
+
+/* Flushes the directory holding `path`, so that its entries are durable */
+static bool
+_scp_snapshot_sync_dir (const char *path)
+{
+  const char *slash = strrchr (path, '/');
+  char *dir;
+  bool synced;
+  int fd;
+
+  if (!slash)
+    dir = strdup (".");
+  else
+    dir = strndup (path, slash == path ? 1UL : (size_t)(slash - path));
+  if (!dir)
+    _die ("%s: Unable to allocate directory path (errno=%d)", __func__,
+          errno);
+
+  fd = open (dir, O_RDONLY | O_DIRECTORY);
+  free (dir);
+  if (fd < 0)
+    return false;
+
+  synced = fsync (fd) == 0;
+  return close (fd) == 0 && synced;
+}
@@ -0,0 +1,376 @@
+/*
+ * strpool_sort.c - [description]
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "strpool_sort.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SCP_RADIX_INSERTION 32U    /* Buckets below this size use insertion */
+#define SCP_RADIX_TASKS_PER_THREAD 4U
+#define SCP_RADIX_MAX_THREADS 64U
+#define SCP_RANK_DIGIT_BITS 11U    /* Digit of the integer sort of ranks */
+#define SCP_RANK_INSERTION 64UL
+
+/* A bucket of identifiers sharing their first `depth` bytes */
+struct _scp_radix_task
+{
+  uint32_t start, n;
+  uint32_t depth;
+};
+
+struct _scp_radix_tasks
+{
+  struct _scp_radix_task *tasks;
+  size_t size, capacity;
+};
+
+/*
+ * State shared by the sorting threads. The identifiers, their scratch copy
+ * and the cached key bytes are split between the tasks, so that each thread
+ * only ever touches the ranges of the tasks it claimed.
+ */
+struct _scp_radix_sort
+{
+  const char *arena;
+  const size_t *offsets;
+  const uint32_t *lengths; /* Exact lengths, if the pool holds views */
+  uint32_t *ids, *tmp;
+  uint8_t *keys;
+
+  struct _scp_radix_tasks roots;
+  atomic_size_t next; /* Next root task to be claimed */
+};
+
+static void _scp_radix_split (struct _scp_radix_sort *sort,
+                              struct _scp_radix_task task,
+                              struct _scp_radix_tasks *children);
+static void *_scp_radix_worker (void *arg);
+static inline uint8_t _scp_radix_byte (const struct _scp_radix_sort *sort,
+                                       uint32_t id, uint32_t depth);
+static int _scp_radix_compare (const struct _scp_radix_sort *sort,
+                               uint32_t a, uint32_t b, uint32_t depth);
+static void _scp_radix_push (struct _scp_radix_tasks *tasks, uint32_t start,
+                             uint32_t n, uint32_t depth);
+static int _scp_radix_task_compare (const void *a, const void *b);
+
+/**
+ * @brief Terminates the program execution due to a critical exception.
+ *
+ * @param fmt Format string for the error message, followed by optional
+ * arguments.
+ * @param ... Optional arguments corresponding to the format string.
+ */
+static void
+_die (const char *fmt, ...)
+{
+  va_list arg;
+
+  va_start (arg, fmt);
+  vfprintf (stderr, fmt, arg);
+  fprintf (stderr, "\n");
+  va_end (arg);
+
+  exit (EXIT_FAILURE);
+}
+
+/**
+ * @brief (Re)builds the rank table of a pool.
+ *
+ * Identifiers are sorted by an MSD radix sort over the bytes of their
+ * strings. Each pass first caches the current byte of every string of the
+ * bucket, so that the arena is read once (and sequentially within each
+ * string) per pass, rather than once per comparison. Buckets are split on
+ * the calling thread until there are enough of them to keep the threads of
+ * the pool busy, and then sorted independently.
+ *
+ * @param pool The string pool to rank.
+ */
+void
+scp_build_ranks (strpool_t *pool)
+{
+  struct _scp_radix_sort sort;
+  struct _scp_radix_tasks pending = { 0 };
+  struct _scp_radix_task task;
+  pthread_t threads[SCP_RADIX_MAX_THREADS];
+  uint32_t i, n = scp_size (pool), count = pool->index.threads;
+  size_t largest;
+
+  free (pool->ranks);
+  pool->ranks = malloc ((n ? n : 1U) * sizeof (*pool->ranks));
+  sort.ids = malloc ((n ? n : 1U) * sizeof (*sort.ids));
+  sort.tmp = malloc ((n ? n : 1U) * sizeof (*sort.tmp));
+  sort.keys = malloc (n ? n : 1U);
+  if (!pool->ranks || !sort.ids || !sort.tmp || !sort.keys)
+    _die ("%s: Unable to allocate rank table (errno=%d)", __func__, errno);
+
+  sort.arena = pool->pool, sort.offsets = pool->offsets;
+  sort.lengths = pool->lengths;
+  sort.roots = (struct _scp_radix_tasks){ 0 };
+  atomic_init (&sort.next, 0UL);
+  for (i = 0U; i < n; ++i)
+    sort.ids[i] = i;
+
+  /* Split the largest buckets until each thread gets several of them */
+  count = count < 1U ? 1U : count > SCP_RADIX_MAX_THREADS ? SCP_RADIX_MAX_THREADS
+                                                            : count;
+  _scp_radix_push (&sort.roots, 0U, n, 0U);
+  while (count > 1U && sort.roots.size)
+    {
+      for (largest = 0UL, i = 1U; i < sort.roots.size; ++i)
+        if (sort.roots.tasks[i].n > sort.roots.tasks[largest].n)
+          largest = i;
+      if (sort.roots.tasks[largest].n
+          <= n / (count * SCP_RADIX_TASKS_PER_THREAD))
+        break;
+
+      task = sort.roots.tasks[largest];
+      sort.roots.tasks[largest] = sort.roots.tasks[--sort.roots.size];
+      _scp_radix_split (&sort, task, &pending);
+      while (pending.size)
+        {
+          task = pending.tasks[--pending.size];
+          _scp_radix_push (&sort.roots, task.start, task.n, task.depth);
+        }
+    }
+  free (pending.tasks);
+
+  /* Claim the largest buckets first, to balance the threads */
+  qsort (sort.roots.tasks, sort.roots.size, sizeof (*sort.roots.tasks),
+         _scp_radix_task_compare);
+  for (i = 1U; i < count; ++i)
+    if (pthread_create (threads + i, NULL, _scp_radix_worker, &sort))
+      _die ("%s: Unable to start sorting thread (errno=%d)", __func__, errno);
+  _scp_radix_worker (&sort);
+  for (i = 1U; i < count; ++i)
+    pthread_join (threads[i], NULL);
+
+  for (i = 0U; i < n; ++i)
+    pool->ranks[sort.ids[i]] = i;
+  pool->ranks_size = n;
+
+  free (sort.roots.tasks);
+  free (sort.ids), free (sort.tmp), free (sort.keys);
+}
+
+/**
+ * @brief Retrieves the lexicographic rank of a string.
+ *
+ * The rank table is rebuilt first if strings were added since it was built.
+ *
+ * @return The rank of the string, or `SCP_INVALID_ID` if `id` is out of range.
+ */
+uint32_t
+scp_rank (strpool_t *pool, uint32_t id)
+{
+  if (id >= scp_size (pool))
+    return SCP_INVALID_ID;
+  if (pool->ranks_size != scp_size (pool))
+    scp_build_ranks (pool);
+  return pool->ranks[id];
+}
+
+/**
+ * @brief Sorts identifiers by the lexicographic order of their strings.
+ *
+ * The identifiers are sorted by rank, with an LSD radix sort over just as
+ * many digits as the ranks span; ties (repeated identifiers) keep their
+ * order. Every identifier must belong to the pool.
+ *
+ * @param pool The string pool the identifiers belong to.
+ * @param ids The identifiers to sort, in place.
+ * @param n The number of identifiers.
+ */
+void
+scp_sort_ids (strpool_t *pool, uint32_t *ids, size_t n)
+{
+  uint64_t *keys, *tmp, *swap, key;
+  size_t i, j, counts[1U << SCP_RANK_DIGIT_BITS], sum, at;
+  uint32_t shift, bits, digit;
+
+  if (pool->ranks_size != scp_size (pool))
+    scp_build_ranks (pool);
+
+  if (n < SCP_RANK_INSERTION)
+    {
+      for (i = 1UL; i < n; ++i)
+        {
+          digit = ids[i];
+          for (j = i; j > 0UL && pool->ranks[ids[j - 1]] > pool->ranks[digit];
+               --j)
+            ids[j] = ids[j - 1];
+          ids[j] = digit;
+        }
+      return;
+    }
+
+  /* Each key carries its rank above its identifier */
+  keys = malloc (n * sizeof (*keys));
+  tmp = malloc (n * sizeof (*tmp));
+  if (!keys || !tmp)
+    _die ("%s: Unable to allocate sort buffers (errno=%d)", __func__, errno);
+  for (i = 0UL; i < n; ++i)
+    keys[i] = (uint64_t)pool->ranks[ids[i]] << 32 | ids[i];
+
+  for (bits = 0U; bits < 32U && (pool->ranks_size - 1U) >> bits; ++bits)
+    ;
+  for (shift = 32U; shift < 32U + bits; shift += SCP_RANK_DIGIT_BITS)
+    {
+      memset (counts, 0, sizeof (counts));
+      for (i = 0UL; i < n; ++i)
+        counts[(keys[i] >> shift) & ((1U << SCP_RANK_DIGIT_BITS) - 1U)]++;
+      for (sum = 0UL, i = 0UL; i < (1U << SCP_RANK_DIGIT_BITS); ++i)
+        at = counts[i], counts[i] = sum, sum += at;
+      for (i = 0UL; i < n; ++i)
+        {
+          key = keys[i];
+          tmp[counts[(key >> shift) & ((1U << SCP_RANK_DIGIT_BITS) - 1U)]++]
+              = key;
+        }
+      swap = keys, keys = tmp, tmp = swap;
+    }
+
+  for (i = 0UL; i < n; ++i)
+    ids[i] = (uint32_t)keys[i];
+  free (keys), free (tmp);
+}
+
+/**
+ * @brief Sorts a bucket by its byte at `task.depth`, and pushes the buckets
+ * that still need sorting by their following bytes.
+ *
+ * Strings ending at `depth` come first, and are fully sorted. Small buckets
+ * are sorted right away by insertion, comparing their remaining bytes.
+ */
+static void
+_scp_radix_split (struct _scp_radix_sort *sort, struct _scp_radix_task task,
+                  struct _scp_radix_tasks *children)
+{
+  uint32_t *ids = sort->ids + task.start, *tmp = sort->tmp + task.start;
+  uint8_t *keys = sort->keys + task.start;
+  uint32_t i, j, id, counts[256] = { 0 }, starts[256], sum;
+
+  if (task.n < SCP_RADIX_INSERTION)
+    {
+      for (i = 1U; i < task.n; ++i)
+        {
+          id = ids[i];
+          for (j = i;
+               j > 0U && _scp_radix_compare (sort, ids[j - 1], id, task.depth)
+                             > 0;
+               --j)
+            ids[j] = ids[j - 1];
+          ids[j] = id;
+        }
+      return;
+    }
+
+  /* Gather the bytes once, then count and scatter from the cache */
+  for (i = 0U; i < task.n; ++i)
+    keys[i] = _scp_radix_byte (sort, ids[i], task.depth);
+  for (i = 0U; i < task.n; ++i)
+    counts[keys[i]]++;
+
+  /* A common byte needs no scattering (shared prefixes, such as URLs) */
+  if (counts[keys[0]] == task.n)
+    {
+      if (keys[0])
+        _scp_radix_push (children, task.start, task.n, task.depth + 1U);
+      return;
+    }
+
+  for (sum = 0U, i = 0U; i < 256U; ++i)
+    starts[i] = sum, sum += counts[i];
+  for (i = 0U; i < task.n; ++i)
+    tmp[starts[keys[i]]++] = ids[i];
+  memcpy (ids, tmp, task.n * sizeof (*ids));
+
+  for (i = 1U; i < 256U; ++i)
+    if (counts[i] > 1U)
+      _scp_radix_push (children, task.start + starts[i] - counts[i],
+                       counts[i], task.depth + 1U);
+}
+
+/* Claims root buckets, and sorts each one depth-first */
+static void *
+_scp_radix_worker (void *arg)
+{
+  struct _scp_radix_sort *sort = arg;
+  struct _scp_radix_tasks stack = { 0 };
+  size_t root;
+
+  while ((root = atomic_fetch_add (&sort->next, 1UL)) < sort->roots.size)
+    {
+      _scp_radix_push (&stack, sort->roots.tasks[root].start,
+                       sort->roots.tasks[root].n,
+                       sort->roots.tasks[root].depth);
+      while (stack.size)
+        _scp_radix_split (sort, stack.tasks[--stack.size], &stack);
+    }
+
+  free (stack.tasks);
+  return NULL;
+}
+
+/* Byte of a string at `depth`, where its end reads as a null byte */
+static inline uint8_t
+_scp_radix_byte (const struct _scp_radix_sort *sort, uint32_t id,
+                 uint32_t depth)
+{
+  if (sort->lengths && depth >= sort->lengths[id])
+    return 0U;
+  return sort->arena[sort->offsets[id] + depth];
+}
+
+/* Compares two strings past their shared first `depth` bytes */
+static int
+_scp_radix_compare (const struct _scp_radix_sort *sort, uint32_t a,
+                    uint32_t b, uint32_t depth)
+{
+  const char *x = sort->arena + sort->offsets[a] + depth;
+  const char *y = sort->arena + sort->offsets[b] + depth;
+  uint32_t m, n;
+  int order;
+
+  if (!sort->lengths)
+    return strcmp (x, y);
+
+  /* Views aren't null-terminated, so compare up to the shorter length */
+  m = sort->lengths[a] - depth, n = sort->lengths[b] - depth;
+  order = strncmp (x, y, m < n ? m : n);
+  if (order)
+    return order;
+  return (m > n) - (m < n);
+}
+
+static void
+_scp_radix_push (struct _scp_radix_tasks *tasks, uint32_t start, uint32_t n,
+                 uint32_t depth)
+{
+  if (tasks->size == tasks->capacity)
+    {
+      tasks->capacity = tasks->capacity ? tasks->capacity << 1 : 64UL;
+      tasks->tasks
+          = realloc (tasks->tasks, tasks->capacity * sizeof (*tasks->tasks));
+      if (!tasks->tasks)
+        _die ("%s: Unable to allocate sort tasks (errno=%d)", __func__,
+              errno);
+    }
+  tasks->tasks[tasks->size++] = (struct _scp_radix_task){ start, n, depth };
+}
+
+/* Orders tasks by decreasing size */
+static int
+_scp_radix_task_compare (const void *a, const void *b)
+{
+  const struct _scp_radix_task *x = a, *y = b;
+  return (x->n < y->n) - (x->n > y->n);
+}
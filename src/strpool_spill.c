@@ -0,0 +1,392 @@
+/*
+ * strpool_spill.c - [description]
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#define _POSIX_C_SOURCE 200809L /* strdup(...), strnlen(...), mkstemp(...) */
+
+#include "strpool_spill.h"
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SCP_SPILL_SEED 0x5B111EDC0FFEE5EDULL
+#define SCP_SPILL_BUFFER_SIZE (256UL << 10) /* Write buffer per partition */
+#define SCP_SPILL_DEFAULT_BUDGET (1ULL << 30)
+#define SCP_SPILL_MAX_FANOUT 256U /* Partitions per split */
+#define SCP_SPILL_MAX_DEPTH 4U    /* Splits of a partition, at most */
+
+static FILE *_scp_spill_file (const char *dir);
+static uint32_t _scp_spill_partition (const char *s, uint32_t len,
+                                      uint64_t seed, uint32_t count);
+static int _scp_spill_read (FILE *file, char **s, size_t *capacity,
+                            uint32_t *len);
+static uint64_t _scp_spill_consume (scp_spill_t *spill, FILE *file,
+                                    uint64_t size, uint32_t depth,
+                                    uint64_t base, scp_spill_sink_t sink,
+                                    void *ctx, char **s, size_t *capacity);
+static uint64_t _scp_spill_split (scp_spill_t *spill, FILE *file,
+                                  uint64_t size, uint32_t depth,
+                                  uint64_t base, scp_spill_sink_t sink,
+                                  void *ctx, char **s, size_t *capacity);
+
+/**
+ * @brief Terminates the program execution due to a critical exception.
+ *
+ * @param fmt Format string for the error message, followed by optional
+ * arguments.
+ * @param ... Optional arguments corresponding to the format string.
+ */
+static void
+_die (const char *fmt, ...)
+{
+  va_list arg;
+
+  va_start (arg, fmt);
+  vfprintf (stderr, fmt, arg);
+  fprintf (stderr, "\n");
+  va_end (arg);
+
+  exit (EXIT_FAILURE);
+}
+
+/**
+ * @brief Creates a spilled set, partitioned into temporary files.
+ *
+ * The files are unlinked as soon as they are created, so that they vanish
+ * along with the set, even if the process crashes.
+ *
+ * @param dir The directory holding the partitions (on local disk, ideally).
+ * @param partitions The number of partitions; partitions exceeding the
+ * budget (see `scp_spill_set_budget(...)`) are split again when the
+ * set is finished, but each split costs another pass over their strings.
+ *
+ * @return The spilled set, or `NULL` (with `errno` set) if the partitions
+ * couldn't be created.
+ */
+scp_spill_t *
+scp_spill_new (const char *dir, uint32_t partitions)
+{
+  scp_spill_t *spill = malloc (sizeof (*spill));
+  uint32_t i;
+  int error;
+
+  if (!spill)
+    _die ("%s: Unable to allocate spilled set (errno=%d)", __func__, errno);
+
+  spill->partition_count = partitions ? partitions : 1U;
+  spill->seed = SCP_SPILL_SEED, spill->count = 0UL, spill->error = 0;
+  spill->budget = SCP_SPILL_DEFAULT_BUDGET;
+  spill->dir = strdup (dir);
+  spill->partitions = calloc (spill->partition_count, sizeof (FILE *));
+  spill->buffers = calloc (spill->partition_count, sizeof (char *));
+  spill->sizes = calloc (spill->partition_count, sizeof (uint64_t));
+  if (!spill->dir || !spill->partitions || !spill->buffers || !spill->sizes)
+    _die ("%s: Unable to allocate partitions (errno=%d)", __func__, errno);
+
+  for (i = 0U; i < spill->partition_count; ++i)
+    {
+      spill->partitions[i] = _scp_spill_file (dir);
+      if (!spill->partitions[i])
+        {
+          error = errno;
+          scp_spill_free (spill);
+          errno = error;
+          return NULL;
+        }
+
+      spill->buffers[i] = malloc (SCP_SPILL_BUFFER_SIZE);
+      if (!spill->buffers[i])
+        _die ("%s: Unable to allocate partition buffer (errno=%d)", __func__,
+              errno);
+      setvbuf (spill->partitions[i], spill->buffers[i], _IOFBF,
+               SCP_SPILL_BUFFER_SIZE);
+    }
+  return spill;
+}
+
+void
+scp_spill_free (scp_spill_t *spill)
+{
+  uint32_t i;
+
+  for (i = 0U; i < spill->partition_count; ++i)
+    {
+      if (spill->partitions[i])
+        fclose (spill->partitions[i]);
+      free (spill->buffers[i]);
+    }
+  free (spill->partitions);
+  free (spill->buffers);
+  free (spill->sizes);
+  free (spill->dir);
+  free (spill);
+}
+
+/**
+ * @brief Overrides the budget of a spilled set (1 GiB by default).
+ *
+ * @param spill The spilled set.
+ * @param budget The largest partition (in bytes written, duplicates and
+ * 4-byte length prefixes included) deduplicated without being split, or zero
+ * to never split partitions.
+ */
+void
+scp_spill_set_budget (scp_spill_t *spill, uint64_t budget)
+{
+  spill->budget = budget;
+}
+
+/**
+ * @brief Adds a string to a spilled set.
+ *
+ * The string is appended to its partition, chosen by hash, so that every
+ * copy of a string lands within the same partition.
+ *
+ * @param spill The spilled set.
+ * @param s The string to add.
+ * @param n The maximum length of `s`, or `-1UL` if it is null-terminated.
+ */
+void
+scp_spill_add (scp_spill_t *spill, const char *s, size_t n)
+{
+  size_t len = n == -1UL ? strlen (s) : strnlen (s, n);
+  uint32_t len32 = len, partition;
+  FILE *file;
+
+  if (len > UINT32_MAX)
+    _die ("%s: Strings are limited to 4 GiB (got %zu bytes)", __func__, len);
+
+  partition = _scp_spill_partition (s, len32, spill->seed,
+                                    spill->partition_count);
+  file = spill->partitions[partition];
+
+  if (fwrite (&len32, sizeof (len32), 1, file) != 1
+      || fwrite (s, 1, len, file) != len)
+    spill->error = spill->error ? spill->error : errno;
+  spill->sizes[partition] += sizeof (len32) + len;
+  spill->count++;
+}
+
+/**
+ * @brief Deduplicates a spilled set, partition by partition.
+ *
+ * Each partition is read back sequentially into a fresh pool (once split, if
+ * it exceeds the budget), and every string it didn't hold yet is handed to
+ * `sink` with its global identifier: the number of distinct strings within
+ * the previous partitions, plus its identifier within the pool.
+ *
+ * @param spill The spilled set, which may be freed (but not added to) after.
+ * @param sink The callback receiving the distinct strings.
+ * @param ctx An opaque pointer handed to `sink`.
+ *
+ * @return The number of distinct strings, or `-1UL` (with `errno` set) if a
+ * partition couldn't be written or read back.
+ */
+uint64_t
+scp_spill_finish (scp_spill_t *spill, scp_spill_sink_t sink, void *ctx)
+{
+  uint64_t base = 0UL;
+  size_t capacity = 256UL;
+  char *s = malloc (capacity);
+  uint32_t i;
+  FILE *file;
+
+  if (!s)
+    _die ("%s: Unable to allocate string buffer (errno=%d)", __func__,
+          errno);
+
+  for (i = 0U; i < spill->partition_count && !spill->error; ++i)
+    {
+      /* The partition is closed as soon as it is consumed, to release its
+         disk space */
+      file = spill->partitions[i], spill->partitions[i] = NULL;
+      base = _scp_spill_consume (spill, file, spill->sizes[i], 0U, base, sink,
+                                 ctx, &s, &capacity);
+    }
+
+  free (s);
+  if (spill->error)
+    {
+      errno = spill->error;
+      return -1UL;
+    }
+  return base;
+}
+
+/* Selects the partition of a string, among `count` */
+static uint32_t
+_scp_spill_partition (const char *s, uint32_t len, uint64_t seed,
+                      uint32_t count)
+{
+  return ((scp_hash64 (s, len, seed) >> 32) * count) >> 32;
+}
+
+/**
+ * @brief Reads the next record of a partition into `*s`, growing it as
+ * needed.
+ *
+ * @return 1 if a record was read, 0 at the end of the partition, or -1 (with
+ * `errno` set) on failure.
+ */
+static int
+_scp_spill_read (FILE *file, char **s, size_t *capacity, uint32_t *len)
+{
+  if (fread (len, sizeof (*len), 1, file) != 1)
+    {
+      if (!ferror (file))
+        return 0;
+      return -1;
+    }
+
+  if (*len >= *capacity)
+    {
+      *capacity = (size_t)*len + 1UL;
+      *s = realloc (*s, *capacity);
+      if (!*s)
+        _die ("%s: Unable to allocate string buffer (errno=%d)", __func__,
+              errno);
+    }
+  if (fread (*s, 1, *len, file) != *len)
+    {
+      if (!ferror (file))
+        errno = EIO; /* Truncated */
+      return -1;
+    }
+  return 1;
+}
+
+/**
+ * @brief Deduplicates a partition (splitting it first if it exceeds the
+ * budget), and closes it.
+ *
+ * @param size The number of bytes written to the partition.
+ * @param depth The number of splits the partition stems from.
+ * @param base The number of distinct strings within the previous partitions.
+ *
+ * @return `base`, plus the number of distinct strings of the partition.
+ */
+static uint64_t
+_scp_spill_consume (scp_spill_t *spill, FILE *file, uint64_t size,
+                    uint32_t depth, uint64_t base, scp_spill_sink_t sink,
+                    void *ctx, char **s, size_t *capacity)
+{
+  strpool_t pool;
+  uint32_t len, id, count;
+  int read;
+
+  if (fflush (file) == EOF || fseek (file, 0L, SEEK_SET) < 0)
+    {
+      spill->error = errno;
+      fclose (file);
+      return base;
+    }
+
+  if (spill->budget && size > spill->budget && depth < SCP_SPILL_MAX_DEPTH)
+    return _scp_spill_split (spill, file, size, depth, base, sink, ctx, s,
+                             capacity);
+
+  pool._dynamic = false;
+  scp_init (&pool);
+  while ((read = _scp_spill_read (file, s, capacity, &len)) > 0)
+    {
+      count = scp_size (&pool);
+      id = scp_insert_bytes (&pool, *s, len);
+      if (scp_size (&pool) != count && sink)
+        sink (ctx, base + id, scp_string (&pool, id), len);
+    }
+  if (read < 0)
+    spill->error = spill->error ? spill->error : errno;
+
+  base += scp_size (&pool);
+  scp_free (&pool);
+  fclose (file);
+  return base;
+}
+
+/**
+ * @brief Splits a partition exceeding the budget into smaller ones, under
+ * another hash, and consumes them in turn.
+ *
+ * A partition that can't shrink (such as one string repeated over and over)
+ * is split again up to `SCP_SPILL_MAX_DEPTH` times, and then deduplicated as
+ * it is.
+ */
+static uint64_t
+_scp_spill_split (scp_spill_t *spill, FILE *file, uint64_t size,
+                  uint32_t depth, uint64_t base, scp_spill_sink_t sink,
+                  void *ctx, char **s, size_t *capacity)
+{
+  uint64_t seed = spill->seed + (depth + 1ULL) * 0x9E3779B97F4A7C15ULL;
+  uint64_t parts = size / spill->budget + 1UL, *sizes;
+  uint32_t count, i, len, at;
+  FILE **files;
+  int read;
+
+  count = parts < SCP_SPILL_MAX_FANOUT ? parts : SCP_SPILL_MAX_FANOUT;
+  files = calloc (count, sizeof (FILE *));
+  sizes = calloc (count, sizeof (uint64_t));
+  if (!files || !sizes)
+    _die ("%s: Unable to allocate partitions (errno=%d)", __func__, errno);
+
+  for (i = 0U; i < count && !spill->error; ++i)
+    if (!(files[i] = _scp_spill_file (spill->dir)))
+      spill->error = errno;
+
+  while (!spill->error && (read = _scp_spill_read (file, s, capacity, &len)))
+    {
+      if (read < 0) /* `len` may not describe `*s` */
+        {
+          spill->error = errno;
+          break;
+        }
+
+      at = _scp_spill_partition (*s, len, seed, count);
+      if (fwrite (&len, sizeof (len), 1, files[at]) != 1
+          || fwrite (*s, 1, len, files[at]) != len)
+        {
+          spill->error = errno;
+          break;
+        }
+      sizes[at] += sizeof (len) + len;
+    }
+  fclose (file);
+
+  for (i = 0U; i < count; ++i)
+    if (files[i] && spill->error)
+      fclose (files[i]);
+    else if (files[i])
+      base = _scp_spill_consume (spill, files[i], sizes[i], depth + 1U, base,
+                                 sink, ctx, s, capacity);
+
+  free (files), free (sizes);
+  return base;
+}
+
+/* Creates an anonymous temporary file within `dir` */
+static FILE *
+_scp_spill_file (const char *dir)
+{
+  char *path = malloc (strlen (dir) + sizeof ("/scp-spill-XXXXXX"));
+  FILE *file;
+  int fd;
+
+  if (!path)
+    _die ("%s: Unable to allocate path (errno=%d)", __func__, errno);
+
+  fd = mkstemp (strcat (strcpy (path, dir), "/scp-spill-XXXXXX"));
+  if (fd >= 0)
+    unlink (path);
+  free (path);
+  if (fd < 0)
+    return NULL;
+
+  file = fdopen (fd, "w+b");
+  if (!file)
+    close (fd);
+  return file;
+}
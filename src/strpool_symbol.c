@@ -0,0 +1,472 @@
+/*
+ * strpool_symbol.c - [description]
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "strpool_symbol.h"
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SCP_SYMBOL_MIN_CAPACITY 64U
+#define SCP_SYMBOL_MAX_CAPACITY (-64U) /* Largest multiple of 64 bits */
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SCP_POPCOUNT64(w) ((uint32_t)__builtin_popcountll (w))
+#define SCP_CTZ64(w) ((uint32_t)__builtin_ctzll (w))
+#else
+#define SCP_POPCOUNT64(w) _scp_popcount64 (w)
+#define SCP_CTZ64(w) _scp_ctz64 (w)
+
+/* Counts the set bits of a word, in parallel within the word (SWAR) */
+static inline uint32_t
+_scp_popcount64 (uint64_t w)
+{
+  w -= (w >> 1) & 0x5555555555555555ULL;
+  w = (w & 0x3333333333333333ULL) + ((w >> 2) & 0x3333333333333333ULL);
+  w = (w + (w >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+  return (uint32_t)((w * 0x0101010101010101ULL) >> 56);
+}
+
+/* Counts the trailing zero bits of a non-zero word */
+static inline uint32_t
+_scp_ctz64 (uint64_t w)
+{
+  return _scp_popcount64 ((w & (0ULL - w)) - 1U);
+}
+#endif
+
+static uint32_t _scp_symbol_grow (uint32_t capacity, uint32_t id);
+static uint32_t _scp_bits_next (const uint64_t *words, uint32_t capacity,
+                                uint32_t id);
+
+/**
+ * @brief Terminates the program execution due to a critical exception.
+ *
+ * @param fmt Format string for the error message, followed by optional
+ * arguments.
+ * @param ... Optional arguments corresponding to the format string.
+ */
+static void
+_die (const char *fmt, ...)
+{
+  va_list arg;
+
+  va_start (arg, fmt);
+  vfprintf (stderr, fmt, arg);
+  fprintf (stderr, "\n");
+  va_end (arg);
+
+  exit (EXIT_FAILURE);
+}
+
+scp_symmap_t *
+scp_symmap_new ()
+{
+  scp_symmap_t *map = malloc (sizeof *map);
+  if (!map)
+    _die ("%s: Unable to allocate symbol map (errno=%d).", __func__, errno);
+  map->_dynamic = true;
+
+  return map;
+}
+
+/**
+ * @brief Initializes an empty symbol map.
+ *
+ * @param map The symbol map to initialize, or `NULL` to allocate one.
+ * @param value_size The size of each value, in bytes (at least one; a symbol
+ * set holds identifiers without values).
+ *
+ * @return The initialized symbol map.
+ */
+scp_symmap_t *
+scp_symmap_init (scp_symmap_t *map, size_t value_size)
+{
+  if (!value_size)
+    _die ("%s: Symbol map values must be at least one byte (use a symbol "
+          "set instead).",
+          __func__);
+  if (!map) /* Ensure that the map is properly allocated */
+    map = scp_symmap_new ();
+
+  map->values = NULL, map->present = NULL;
+  map->value_size = value_size;
+  map->capacity = 0U, map->size = 0U;
+  return map;
+}
+
+void
+scp_symmap_free (scp_symmap_t *map)
+{
+  free (map->values);
+  free (map->present);
+
+  if (map->_dynamic)
+    free (map);
+}
+
+/**
+ * @brief Ensures that a symbol map covers the identifiers [0, capacity).
+ *
+ * Values of the new identifiers are absent (and zeroed).
+ */
+void
+scp_symmap_reserve (scp_symmap_t *map, uint32_t capacity)
+{
+  uint32_t new_capacity;
+
+  if (capacity <= map->capacity)
+    return;
+
+  new_capacity = _scp_symbol_grow (map->capacity, capacity - 1U);
+  map->values = realloc (map->values, (size_t)new_capacity * map->value_size);
+  map->present = realloc (map->present, new_capacity / 8U);
+  if (!map->values || !map->present)
+    _die ("%s: Unable to resize symbol map (errno=%d)", __func__, errno);
+
+  memset (map->values + (size_t)map->capacity * map->value_size, 0,
+          (size_t)(new_capacity - map->capacity) * map->value_size);
+  memset (map->present + map->capacity / 64U, 0,
+          (new_capacity - map->capacity) / 8U);
+  map->capacity = new_capacity;
+}
+
+/* Ensures that a symbol map covers every identifier of a pool */
+void
+scp_symmap_fit (scp_symmap_t *map, strpool_t *pool)
+{
+  scp_symmap_reserve (map, scp_size (pool));
+}
+
+/**
+ * @brief Associates a value with an identifier, replacing any previous one.
+ *
+ * @param map The symbol map to update.
+ * @param id The identifier, which may exceed the capacity of the map.
+ * @param value The value to copy, or `NULL` to zero it.
+ *
+ * @return The value stored within the map, which is only valid until the map
+ * is next resized.
+ */
+void *
+scp_symmap_put (scp_symmap_t *map, uint32_t id, const void *value)
+{
+  char *slot;
+
+  if (id >= map->capacity)
+    scp_symmap_reserve (map, id + 1U);
+
+  slot = map->values + (size_t)id * map->value_size;
+  if (value)
+    memcpy (slot, value, map->value_size);
+  else
+    memset (slot, 0, map->value_size);
+
+  if (!(map->present[id / 64U] >> (id % 64U) & 1U))
+    map->present[id / 64U] |= 1ULL << (id % 64U), map->size++;
+  return slot;
+}
+
+/**
+ * @brief Retrieves the value associated with an identifier.
+ *
+ * @return The value stored within the map, or `NULL` if the identifier has
+ * no value.
+ */
+void *
+scp_symmap_get (const scp_symmap_t *map, uint32_t id)
+{
+  if (id >= map->capacity || !(map->present[id / 64U] >> (id % 64U) & 1U))
+    return NULL;
+  return map->values + (size_t)id * map->value_size;
+}
+
+/**
+ * @brief Removes the value associated with an identifier.
+ *
+ * @return `true` if the identifier had a value, `false` otherwise.
+ */
+bool
+scp_symmap_remove (scp_symmap_t *map, uint32_t id)
+{
+  if (id >= map->capacity || !(map->present[id / 64U] >> (id % 64U) & 1U))
+    return false;
+
+  map->present[id / 64U] &= ~(1ULL << (id % 64U)), map->size--;
+  memset (map->values + (size_t)id * map->value_size, 0, map->value_size);
+  return true;
+}
+
+void
+scp_symmap_clear (scp_symmap_t *map)
+{
+  if (!map->capacity)
+    return;
+
+  memset (map->values, 0, (size_t)map->capacity * map->value_size);
+  memset (map->present, 0, map->capacity / 8U);
+  map->size = 0U;
+}
+
+/**
+ * @brief Searches the next identifier with a value, for iteration in
+ * identifier order (starting from zero).
+ *
+ * @return The smallest identifier not less than `id` with a value, or
+ * `SCP_INVALID_ID` if there is none.
+ */
+uint32_t
+scp_symmap_next (const scp_symmap_t *map, uint32_t id)
+{
+  return _scp_bits_next (map->present, map->capacity, id);
+}
+
+uint32_t
+scp_symmap_size (const scp_symmap_t *map)
+{
+  return map->size;
+}
+
+scp_symset_t *
+scp_symset_new ()
+{
+  scp_symset_t *set = malloc (sizeof *set);
+  if (!set)
+    _die ("%s: Unable to allocate symbol set (errno=%d).", __func__, errno);
+  set->_dynamic = true;
+
+  return set;
+}
+
+scp_symset_t *
+scp_symset_init (scp_symset_t *set)
+{
+  if (!set) /* Ensure that the set is properly allocated */
+    set = scp_symset_new ();
+
+  set->words = NULL, set->capacity = 0U;
+  return set;
+}
+
+void
+scp_symset_free (scp_symset_t *set)
+{
+  free (set->words);
+
+  if (set->_dynamic)
+    free (set);
+}
+
+/* Ensures that a symbol set covers the identifiers [0, capacity) */
+void
+scp_symset_reserve (scp_symset_t *set, uint32_t capacity)
+{
+  uint32_t new_capacity;
+
+  if (capacity <= set->capacity)
+    return;
+
+  new_capacity = _scp_symbol_grow (set->capacity, capacity - 1U);
+  set->words = realloc (set->words, new_capacity / 8U);
+  if (!set->words)
+    _die ("%s: Unable to resize symbol set (errno=%d)", __func__, errno);
+
+  memset (set->words + set->capacity / 64U, 0,
+          (new_capacity - set->capacity) / 8U);
+  set->capacity = new_capacity;
+}
+
+/* Ensures that a symbol set covers every identifier of a pool */
+void
+scp_symset_fit (scp_symset_t *set, strpool_t *pool)
+{
+  scp_symset_reserve (set, scp_size (pool));
+}
+
+/**
+ * @brief Adds an identifier to a symbol set.
+ *
+ * @return `true` if the identifier was added, `false` if it was present.
+ */
+bool
+scp_symset_add (scp_symset_t *set, uint32_t id)
+{
+  uint64_t bit = 1ULL << (id % 64U);
+
+  if (id >= set->capacity)
+    scp_symset_reserve (set, id + 1U);
+  if (set->words[id / 64U] & bit)
+    return false;
+
+  set->words[id / 64U] |= bit;
+  return true;
+}
+
+/**
+ * @brief Removes an identifier from a symbol set.
+ *
+ * @return `true` if the identifier was removed, `false` if it was absent.
+ */
+bool
+scp_symset_remove (scp_symset_t *set, uint32_t id)
+{
+  if (!scp_symset_contains (set, id))
+    return false;
+
+  set->words[id / 64U] &= ~(1ULL << (id % 64U));
+  return true;
+}
+
+bool
+scp_symset_contains (const scp_symset_t *set, uint32_t id)
+{
+  return id < set->capacity && (set->words[id / 64U] >> (id % 64U) & 1U);
+}
+
+void
+scp_symset_clear (scp_symset_t *set)
+{
+  if (set->capacity)
+    memset (set->words, 0, set->capacity / 8U);
+}
+
+/**
+ * @brief Searches the next identifier of a symbol set, for iteration in
+ * identifier order (starting from zero).
+ *
+ * @return The smallest identifier of the set not less than `id`, or
+ * `SCP_INVALID_ID` if there is none.
+ */
+uint32_t
+scp_symset_next (const scp_symset_t *set, uint32_t id)
+{
+  return _scp_bits_next (set->words, set->capacity, id);
+}
+
+uint32_t
+scp_symset_count (const scp_symset_t *set)
+{
+  uint32_t i, count = 0U;
+
+  for (i = 0U; i < set->capacity / 64U; ++i)
+    count += SCP_POPCOUNT64 (set->words[i]);
+  return count;
+}
+
+/*
+ * The set algebra below runs a plain loop over whole words, free of branches
+ * and aliasing, which compilers turn into vector instructions of whatever
+ * width the target supports.
+ */
+
+/* Adds every identifier of `other` to `set` */
+void
+scp_symset_union (scp_symset_t *set, const scp_symset_t *other)
+{
+  uint64_t *restrict dst;
+  const uint64_t *restrict src;
+  uint32_t i, words = other->capacity / 64U;
+
+  if (set == other)
+    return;
+
+  scp_symset_reserve (set, other->capacity);
+  dst = set->words, src = other->words;
+  for (i = 0U; i < words; ++i)
+    dst[i] |= src[i];
+}
+
+/* Removes every identifier from `set` that `other` lacks */
+void
+scp_symset_intersect (scp_symset_t *set, const scp_symset_t *other)
+{
+  uint64_t *restrict dst = set->words;
+  const uint64_t *restrict src = other->words;
+  uint32_t i, words, common;
+
+  if (set == other)
+    return;
+
+  words = set->capacity / 64U;
+  common = other->capacity < set->capacity ? other->capacity / 64U : words;
+  for (i = 0U; i < common; ++i)
+    dst[i] &= src[i];
+  if (common < words)
+    memset (dst + common, 0, (words - common) * sizeof (*dst));
+}
+
+/* Removes every identifier of `other` from `set` */
+void
+scp_symset_difference (scp_symset_t *set, const scp_symset_t *other)
+{
+  uint64_t *restrict dst = set->words;
+  const uint64_t *restrict src = other->words;
+  uint32_t i, common;
+
+  if (set == other)
+    {
+      scp_symset_clear (set);
+      return;
+    }
+
+  common = other->capacity < set->capacity ? other->capacity : set->capacity;
+  for (i = 0U; i < common / 64U; ++i)
+    dst[i] &= ~src[i];
+}
+
+/* Counts the identifiers shared by two sets, without materializing them */
+uint32_t
+scp_symset_intersect_count (const scp_symset_t *set,
+                            const scp_symset_t *other)
+{
+  uint32_t i, count = 0U, common;
+
+  common = other->capacity < set->capacity ? other->capacity : set->capacity;
+  for (i = 0U; i < common / 64U; ++i)
+    count += SCP_POPCOUNT64 (set->words[i] & other->words[i]);
+  return count;
+}
+
+/**
+ * @brief Computes the capacity needed to cover an identifier, doubling the
+ * current capacity so that growing one identifier at a time stays amortized.
+ */
+static uint32_t
+_scp_symbol_grow (uint32_t capacity, uint32_t id)
+{
+  uint64_t new_capacity = capacity ? capacity : SCP_SYMBOL_MIN_CAPACITY;
+
+  if (id >= SCP_SYMBOL_MAX_CAPACITY)
+    _die ("%s: Identifier %u exceeds the symbol container limit.", __func__,
+          id);
+
+  while (new_capacity <= id)
+    new_capacity <<= 1;
+  return new_capacity > SCP_SYMBOL_MAX_CAPACITY ? SCP_SYMBOL_MAX_CAPACITY
+                                                : (uint32_t)new_capacity;
+}
+
+/* Searches the first set bit at or after `id` */
+static uint32_t
+_scp_bits_next (const uint64_t *words, uint32_t capacity, uint32_t id)
+{
+  uint32_t i;
+  uint64_t word;
+
+  if (id >= capacity)
+    return SCP_INVALID_ID;
+
+  i = id / 64U, word = words[i] & (~0ULL << (id % 64U));
+  while (!word)
+    {
+      if (++i == capacity / 64U)
+        return SCP_INVALID_ID;
+      word = words[i];
+    }
+  return i * 64U + SCP_CTZ64 (word);
+}
@@ -0,0 +1,189 @@
+/*
+ * strpool_tuple.c - [description]
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include "strpool_tuple.h"
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SCP_TUPLE_STACK_KEY 16U /* Variable-length keys built on the stack */
+
+static uint32_t _scp_tuple_find (scp_tuple_t *tuples, const uint32_t *ids,
+                                 uint32_t n, bool create);
+
+/**
+ * @brief Terminates the program execution due to a critical exception.
+ *
+ * @param fmt Format string for the error message, followed by optional
+ * arguments.
+ * @param ... Optional arguments corresponding to the format string.
+ */
+static void
+_die (const char *fmt, ...)
+{
+  va_list arg;
+
+  va_start (arg, fmt);
+  vfprintf (stderr, fmt, arg);
+  fprintf (stderr, "\n");
+  va_end (arg);
+
+  exit (EXIT_FAILURE);
+}
+
+scp_tuple_t *
+scp_tuple_new ()
+{
+  scp_tuple_t *tuples = malloc (sizeof *tuples);
+  if (!tuples)
+    _die ("%s: Unable to allocate tuple pool (errno=%d).", __func__, errno);
+  tuples->_dynamic = true;
+
+  return tuples;
+}
+
+/**
+ * @brief Initializes an empty tuple pool.
+ *
+ * @param tuples The tuple pool to initialize, or `NULL` to allocate one.
+ * @param arity The length of every tuple (such as 2 for pairs), or zero to
+ * accept tuples of any length.
+ *
+ * @return The initialized tuple pool.
+ */
+scp_tuple_t *
+scp_tuple_init (scp_tuple_t *tuples, uint32_t arity)
+{
+  if (!tuples) /* Ensure that the pool is properly allocated */
+    tuples = scp_tuple_new ();
+
+  tuples->pool._dynamic = false;
+  scp_init (&tuples->pool);
+  scp_set_alignment (&tuples->pool, sizeof (uint32_t));
+  tuples->arity = arity;
+  return tuples;
+}
+
+void
+scp_tuple_free (scp_tuple_t *tuples)
+{
+  scp_free (&tuples->pool);
+
+  if (tuples->_dynamic)
+    free (tuples);
+}
+
+/**
+ * @brief Interns a tuple of identifiers, and retrieves its identifier.
+ *
+ * @param tuples The tuple pool to insert the tuple into.
+ * @param ids The identifiers of the tuple.
+ * @param n The length of the tuple, which must match the arity of the pool
+ * (if fixed).
+ *
+ * @return The identifier of the tuple, or `SCP_INVALID_ID` if its length
+ * doesn't match the arity of the pool.
+ */
+uint32_t
+scp_tuple_insert (scp_tuple_t *tuples, const uint32_t *ids, uint32_t n)
+{
+  return _scp_tuple_find (tuples, ids, n, true);
+}
+
+/**
+ * @brief Retrieves the identifier of a tuple without inserting it.
+ *
+ * @return The identifier of the tuple, or `SCP_INVALID_ID` if the pool
+ * doesn't contain it.
+ */
+uint32_t
+scp_tuple_lookup (scp_tuple_t *tuples, const uint32_t *ids, uint32_t n)
+{
+  return _scp_tuple_find (tuples, ids, n, false);
+}
+
+/**
+ * @brief Resolves an identifier into its tuple.
+ *
+ * @param tuples The tuple pool to search.
+ * @param id The identifier of the tuple.
+ * @param n Receives the length of the tuple (may be `NULL`).
+ *
+ * @return The identifiers of the tuple, valid until the next insertion of a
+ * new tuple, or `NULL` if the identifier is unknown.
+ */
+const uint32_t *
+scp_tuple_get (scp_tuple_t *tuples, uint32_t id, uint32_t *n)
+{
+  const uint32_t *key = (const uint32_t *)scp_string (&tuples->pool, id);
+
+  if (!key)
+    return NULL;
+
+  if (!tuples->arity)
+    {
+      if (n)
+        *n = key[0];
+      return key + 1;
+    }
+
+  if (n)
+    *n = tuples->arity;
+  return key;
+}
+
+uint32_t
+scp_tuple_size (scp_tuple_t *tuples)
+{
+  return scp_size (&tuples->pool);
+}
+
+size_t
+scp_tuple_memory_usage (scp_tuple_t *tuples)
+{
+  return scp_memory_usage (&tuples->pool) - sizeof (tuples->pool)
+         + sizeof (*tuples);
+}
+
+/**
+ * @brief Looks a tuple up by its raw bytes, inserting it if requested.
+ *
+ * Fixed-arity tuples are their own keys. Variable-length tuples are keyed by
+ * their length followed by their identifiers, which is assembled on the stack
+ * unless the tuple is long.
+ */
+static uint32_t
+_scp_tuple_find (scp_tuple_t *tuples, const uint32_t *ids, uint32_t n,
+                 bool create)
+{
+  uint32_t stack_key[SCP_TUPLE_STACK_KEY + 1U], *key = stack_key, id;
+  size_t len = (n + 1ULL) * sizeof (*ids);
+
+  if (tuples->arity)
+    {
+      if (n != tuples->arity)
+        return SCP_INVALID_ID;
+      return create ? scp_insert_bytes (&tuples->pool, (const char *)ids,
+                                        n * sizeof (*ids))
+                    : scp_lookup_bytes (&tuples->pool, (const char *)ids,
+                                        n * sizeof (*ids));
+    }
+
+  if (n > SCP_TUPLE_STACK_KEY && !(key = malloc (len)))
+    _die ("%s: Unable to allocate tuple key (errno=%d)", __func__, errno);
+
+  key[0] = n;
+  memcpy (key + 1, ids, n * sizeof (*ids));
+  id = create ? scp_insert_bytes (&tuples->pool, (const char *)key, len)
+              : scp_lookup_bytes (&tuples->pool, (const char *)key, len);
+
+  if (key != stack_key)
+    free (key);
+  return id;
+}